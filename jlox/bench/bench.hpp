@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common/common.hpp"
+#include "script/interpreter.hpp"
+#include "script/parser.hpp"
+#include "script/vm.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+class Context {
+public:
+    Context(const std::string& filter);
+
+    // Calls `body` until `min_time_ns` have passed and reports the mean time and heap allocations of one of the `ops`
+    // operations a single call performs.
+    void measure(const std::string& name, u64 ops, const std::function<void()>& body);
+
+    // Same as measure() but reports how many megabytes of input a second `body` gets through.
+    void measure_throughput(const std::string& name, u64 bytes, const std::function<void()>& body);
+
+    // Reports the bytes requested from operator new per object for one call of `body` that creates `objects` objects.
+    // A first call is not counted, it sets up what every later call shares.
+    void measure_memory(const std::string& name, u64 objects, const std::function<void()>& body);
+
+    // Whether the benchmark `name` matches the filter, for benchmarks that report something of their own.
+    bool selected(const std::string& name) const;
+
+private:
+    static constexpr u64 min_time_ns = 500'000'000;
+
+    struct Sample {
+        u64 iterations;
+        u64 elapsed_ns;
+        u64 allocations;
+    };
+
+    std::string _filter;
+
+    Sample run(const std::function<void()>& body);
+};
+
+struct Benchmark {
+    const char* name;
+    void (*function)(Context& context);
+};
+
+// Number of calls to the global operator new and the bytes they asked for since the process started.
+u64 allocation_count();
+u64 allocated_bytes();
+
+// A parsed and resolved script, the statements stay alive as long as the script does. Without `fusion` neither the
+// interpreter nor the vm run sequences of nodes as one operation.
+class Script {
+public:
+    Script(const std::string& source, bool fusion = true);
+
+    std::vector<script::Node::ptr>& statements();
+
+    // Runs every statement with the tree-walking interpreter.
+    void run(script::Interpreter& interpreter);
+
+    // Compiles every statement for the vm, pass the result to run(). Without `registers` only stack instructions are
+    // used.
+    std::vector<Arc<script::FunctionProto>> compile(script::VM& vm, bool registers = true);
+    void run(script::VM& vm, std::vector<Arc<script::FunctionProto>>& functions);
+
+private:
+    Box<script::Program> _program;
+    bool _fusion;
+};
+
+// Generates a script out of `units` copies of a block that declares a function, a class and a few globals and uses
+// most of the syntax of the language.
+std::string synthetic_script(u32 units);
+
+void lex(Context& context);
+void parse(Context& context);
+void resolve(Context& context);
+void execute(Context& context);
+void dispatch(Context& context);
+void loops(Context& context);
+void variable_access(Context& context);
+void instance_memory(Context& context);
+void gc(Context& context);
+
+} // namespace bench
@@ -0,0 +1,92 @@
+#include "bench.hpp"
+
+#include <iostream>
+#include <fmt/core.h>
+
+namespace bench {
+
+struct Workload {
+    const char* name;
+    const char* source;
+    // instructions the vm runs for the whole script, compiled to stack instructions only and with register ones
+    u64 stack_instructions;
+    u64 register_instructions;
+};
+
+// fib(30) makes 1346268 calls that recurse and 1346269 that return `n`.
+static const Workload fib_30 = { "fib_30", R"(
+fun fib(n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+var result = fib(30);
+)",
+                                 1346268ull * 17 + 1346269ull * 7, 1346268ull * 9 + 1346269ull * 3 };
+
+// Counted per iteration of the inner loop, the outer loop adds less than 0.2% to that.
+static const Workload nested_loops = { "nested_loops", R"(
+{
+    var sum = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+        for (var j = 0; j < 1000; j = j + 1) {
+            sum = sum + j;
+        }
+    }
+}
+)",
+                                       1000ull * 1000 * 16, 1000ull * 1000 * 4 };
+
+static const Workload arithmetic = { "arithmetic", R"(
+{
+    var a = 3;
+    var b = 4;
+    var c = 10;
+    var d = 5;
+    var sum = 0;
+    for (var i = 0; i < 100000; i = i + 1) {
+        sum = sum + a * b + c / d;
+    }
+}
+)",
+                                     100000ull * 22, 100000ull * 9 };
+
+// Reports the time per executed instruction of the vm, most of which is the dispatch for short instructions like these.
+// The tree-walking interpreter does the same work with two virtual calls per node, its time is divided by the number
+// of stack instructions to compare it with the vm.
+void dispatch(Context& context) {
+    for (auto& workload : { fib_30, nested_loops, arithmetic }) {
+        Script script(workload.source);
+
+        script::Interpreter interpreter;
+        context.measure(fmt::format("dispatch/ast/{}", workload.name), workload.stack_instructions, [&] {
+            script.run(interpreter);
+        });
+
+        script::VM vm;
+        auto functions = script.compile(vm, true);
+        context.measure(fmt::format("dispatch/vm/{}", workload.name), workload.register_instructions, [&] {
+            script.run(vm, functions);
+        });
+
+        // the same register instructions, none of them quickened to their number fast path
+        script::VM generic_vm;
+        generic_vm.set_quickening(false);
+        auto generic_functions = script.compile(generic_vm, true);
+        context.measure(fmt::format("dispatch/vm_generic/{}", workload.name), workload.register_instructions, [&] {
+            script.run(generic_vm, generic_functions);
+        });
+
+        auto stack_functions = script.compile(vm, false);
+        context.measure(fmt::format("dispatch/vm_stack/{}", workload.name), workload.stack_instructions, [&] {
+            script.run(vm, stack_functions);
+        });
+
+        std::string name = fmt::format("dispatch/instructions/{}", workload.name);
+        if (context.selected(name)) {
+            std::cout << fmt::format("{:<40} {:>14} stack {:>14} register instructions\n", name,
+                                     workload.stack_instructions, workload.register_instructions);
+        }
+    }
+}
+
+} // namespace bench
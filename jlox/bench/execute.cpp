@@ -0,0 +1,178 @@
+#include "bench.hpp"
+
+#include <stdexcept>
+#include <fmt/core.h>
+
+namespace bench {
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+// Scripts must not print, results are kept in variables so the work can't be skipped.
+static const Workload workloads[] = {
+    { "fib_20", R"(
+fun fib(n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+var result = fib(20);
+)" },
+    { "nested_loops", R"(
+{
+    var sum = 0;
+    for (var i = 0; i < 300; i = i + 1) {
+        for (var j = 0; j < 300; j = j + 1) {
+            sum = sum + j;
+        }
+    }
+}
+)" },
+    { "string_concat", R"(
+{
+    var text = "";
+    for (var i = 0; i < 1000; i = i + 1) {
+        text = text + "x";
+    }
+}
+)" },
+    { "string_build_10000", R"(
+{
+    var text = "";
+    for (var i = 0; i < 10000; i = i + 1) {
+        text = text + "x";
+    }
+    if (text != text + "") text = "";
+}
+)" },
+    { "string_equality", R"(
+{
+    var state = "running";
+    var matches = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+        if (state == "running") matches = matches + 1;
+        if (state == "stopped") matches = matches - 1;
+    }
+}
+)" },
+    { "closures", R"(
+fun make_counter() {
+    var count = 0;
+    fun counter() {
+        count = count + 1;
+        return count;
+    }
+    return counter;
+}
+{
+    var total = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+        var counter = make_counter();
+        counter();
+        total = total + counter();
+    }
+}
+)" },
+    { "class_instances", R"(
+class Point {}
+{
+    var sum = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+        var point = Point();
+        point.x = i;
+        point.y = i * 2;
+        sum = sum + point.x + point.y;
+    }
+}
+)" },
+    { "property_access", R"(
+class Point {}
+{
+    var point = Point();
+    point.x = 1;
+    point.y = 2;
+    var sum = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+        point.x = point.y + i;
+        sum = sum + point.x + point.y;
+    }
+}
+)" },
+};
+
+// Literals, grouping, conditionals, logical operators, variables and arguments only pass handles of the same interned
+// strings around, none of them may copy the characters.
+static std::string string_literal_chain(u32 iterations) {
+    return fmt::format(R"(
+fun pick(a, b) {{ return a == b and a or b; }}
+{{
+    var count = 0;
+    for (var i = 0; i < {}; i = i + 1) {{
+        var text = "a string literal that is too long for the small string buffer";
+        var copy = (text);
+        var other = copy == text ? "another literal that does not fit into the small string buffer" : text;
+        if (pick(copy, other) != "" or other) count = count + 1;
+    }}
+}}
+)",
+                       iterations);
+}
+
+// Allocations of one call of `run`, after a first call that sets up what every call shares.
+template<typename Run>
+static u64 allocations_of(Run run) {
+    run();
+    u64 allocations = allocation_count();
+    run();
+    return allocation_count() - allocations;
+}
+
+// Fails the benchmark run if evaluating the chain allocates more the more often it runs.
+static void check_string_literal_chain(Context& context) {
+    Script few(string_literal_chain(10));
+    Script many(string_literal_chain(1000));
+
+    // The first long run grows the buffers the heap and the interpreter keep between runs, also when the benchmark
+    // itself is filtered out.
+    script::Interpreter interpreter;
+    many.run(interpreter);
+    context.measure("execute/ast/string_literal_chain", 1, [&] {
+        many.run(interpreter);
+    });
+    bool ast_copies = allocations_of([&] { few.run(interpreter); }) != allocations_of([&] { many.run(interpreter); });
+
+    script::VM vm;
+    auto few_functions = few.compile(vm);
+    auto many_functions = many.compile(vm);
+    many.run(vm, many_functions);
+    context.measure("execute/vm/string_literal_chain", 1, [&] {
+        many.run(vm, many_functions);
+    });
+    bool vm_copies = allocations_of([&] { few.run(vm, few_functions); }) !=
+                     allocations_of([&] { many.run(vm, many_functions); });
+
+    if (ast_copies || vm_copies)
+        throw std::runtime_error("evaluating string literals allocates memory");
+}
+
+void execute(Context& context) {
+    for (auto& workload : workloads) {
+        Script script(workload.source);
+
+        script::Interpreter interpreter;
+        context.measure(fmt::format("execute/ast/{}", workload.name), 1, [&] {
+            script.run(interpreter);
+        });
+
+        script::VM vm;
+        auto functions = script.compile(vm);
+        context.measure(fmt::format("execute/vm/{}", workload.name), 1, [&] {
+            script.run(vm, functions);
+        });
+    }
+
+    check_string_literal_chain(context);
+}
+
+} // namespace bench
@@ -0,0 +1,89 @@
+#include "bench.hpp"
+
+#include "script/resolver.hpp"
+
+#include <fmt/core.h>
+
+namespace bench {
+
+static constexpr u32 units = 2000;
+
+std::string synthetic_script(u32 units) {
+    std::string script;
+
+    for (u32 i = 0; i < units; i++) {
+        script += fmt::format(R"(fun function_{0}(a, b) {{
+    var sum = 0;
+    for (var i = 0; i < a; i = i + 1) {{
+        if (i > b and i != 3) sum = sum + i * 2 - (b / 3); else sum = sum - 1;
+    }}
+    return sum;
+}}
+
+class Class_{0} {{
+    describe(other) {{
+        return other.name + " number {0}";
+    }}
+}}
+
+var value_{0} = function_{0}(10, 2) + 1.5;
+var instance_{0} = Class_{0}();
+instance_{0}.name = "instance";
+print !(value_{0} >= 7) ? -value_{0} : nil;
+)",
+                              i);
+    }
+
+    return script;
+}
+
+// Long comments, deep indentation, long names and long strings: the runs the lexer can skip a vector at a time.
+static std::string commented_script(u32 units) {
+    std::string script;
+
+    for (u32 i = 0; i < units; i++) {
+        script += fmt::format(R"(
+        // Adds the counter of unit {0} to the running total of every unit declared before it, so the total grows.
+        // The value is only ever read back by the next unit, which keeps the chain of dependencies linear.
+        var accumulated_total_of_unit_number_{0} = accumulated_total_of_unit_number_{0} + {0}.25;
+        var description_of_unit_number_{0} = "a rather long description of what unit {0} is meant to do";
+)",
+                              i);
+    }
+
+    return script;
+}
+
+static void lex_source(Context& context, const std::string& name, const std::string& source) {
+    context.measure_throughput(name, source.size(), [&] {
+        script::Lexer lexer(source);
+        while (lexer.next().type != script::TT_EOF) {
+        }
+    });
+}
+
+void lex(Context& context) {
+    lex_source(context, fmt::format("lex/synthetic_{}", units), synthetic_script(units));
+    lex_source(context, fmt::format("lex/commented_{}", units), commented_script(units));
+}
+
+void parse(Context& context) {
+    std::string source = synthetic_script(units);
+
+    context.measure(fmt::format("parse/synthetic_{}", units), 1, [&] {
+        script::Parser parser(create_box<script::Source>(source));
+        auto program = parser.parse();
+    });
+}
+
+void resolve(Context& context) {
+    script::Parser parser(create_box<script::Source>(synthetic_script(units)));
+    auto program = parser.parse();
+
+    context.measure(fmt::format("resolve/synthetic_{}", units), 1, [&] {
+        script::Resolver resolver;
+        resolver.run(program->statements);
+    });
+}
+
+} // namespace bench
@@ -0,0 +1,88 @@
+#include "bench.hpp"
+
+#include <iostream>
+#include <fmt/core.h>
+
+namespace bench {
+
+static constexpr u32 instance_count = 10000;
+static constexpr u32 live_instance_count = 200000;
+static constexpr u32 churn_runs = 100;
+
+// Runs `churn` while the heap holds a large live list and reports the pauses it caused. The script keeps chains of
+// instances alive for a while so they get promoted and the old generation keeps growing.
+static void measure_pauses(Context& context, const std::string& name, u64 pause_target_us, Script& churn,
+                           script::Interpreter& interpreter) {
+    if (!context.selected(name))
+        return;
+
+    interpreter.set_gc_pause_target(pause_target_us);
+
+    auto before = interpreter.gc_stats();
+    for (u32 i = 0; i < churn_runs; i++) {
+        churn.run(interpreter);
+    }
+    auto& after = interpreter.gc_stats();
+
+    u64 pauses = 0;
+    u64 long_pauses = 0;
+    usize longest = 0;
+    for (usize i = 0; i < script::PauseHistogram::bucket_count; i++) {
+        u64 count = after.pauses.buckets[i] - before.pauses.buckets[i];
+        pauses += count;
+        if (count)
+            longest = i;
+        if (count && script::PauseHistogram::bucket_limit_us(i) > 2048)
+            long_pauses += count;
+    }
+
+    std::cout << fmt::format("{:<40} {:>8} pauses {:>6} over 2 ms {:>8} major slices  longest < {} us\n", name, pauses,
+                             long_pauses, after.slices - before.slices,
+                             script::PauseHistogram::bucket_limit_us(longest));
+
+    interpreter.set_gc_pause_target(script::Heap::default_pause_target_ns / 1000);
+}
+
+// Time of a full collection while a global linked list of `instance_count` instances is alive, reported per instance.
+// Nothing is garbage, every call marks the whole list and sweeps without freeing.
+void gc(Context& context) {
+    Script script(fmt::format("class Node {{}}\n"
+                              "var head = nil;\n"
+                              "for (var i = 0; i < {}; i = i + 1) {{ "
+                              "var node = Node(); node.next = head; node.value = i; head = node; }}",
+                              instance_count));
+    script::Interpreter interpreter;
+    script.run(interpreter);
+
+    context.measure("gc/full_collection", instance_count, [&] {
+        script::Heap::instance().collect();
+    });
+
+    // Instances and strings that are garbage right after they are created, allocating and collecting them per object.
+    Script garbage(fmt::format("class Point {{}}\n"
+                               "{{ for (var i = 0; i < {}; i = i + 1) {{ "
+                               "var point = Point(); point.name = \"p\" + i; }} }}",
+                               instance_count));
+
+    context.measure("gc/short_lived_objects", instance_count * 2, [&] {
+        garbage.run(interpreter);
+    });
+
+    // Pauses while `live_instance_count` instances stay alive, once collecting the old generation in one go and once
+    // incrementally with the default pause target.
+    Script live(fmt::format("class Big {{}}\n"
+                            "var big = nil;\n"
+                            "for (var i = 0; i < {}; i = i + 1) {{ "
+                            "var node = Big(); node.next = big; node.value = i; big = node; }}",
+                            live_instance_count));
+    Script churn("{ var chain = nil; var length = 0; for (var i = 0; i < 50000; i = i + 1) { "
+                 "var node = Node(); node.next = chain; node.value = i; chain = node; length = length + 1; "
+                 "if (length == 20000) { chain = nil; length = 0; } } }");
+    if (context.selected("gc/pauses"))
+        live.run(interpreter);
+
+    measure_pauses(context, "gc/pauses_atomic", 0, churn, interpreter);
+    measure_pauses(context, "gc/pauses_incremental", script::Heap::default_pause_target_ns / 1000, churn, interpreter);
+}
+
+} // namespace bench
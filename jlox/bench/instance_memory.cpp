@@ -0,0 +1,33 @@
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+namespace bench {
+
+static constexpr u32 instance_count = 10000;
+
+// Keeps `instance_count` instances with `field_count` fields alive in a linked list, `next` is one of the fields.
+static std::string instance_list(u32 field_count) {
+    std::string fields;
+    for (u32 i = 1; i < field_count; i++) {
+        fields += fmt::format("node.field_{} = i; ", i);
+    }
+
+    return fmt::format("class Node {{}}\n"
+                       "{{ var head = nil; for (var i = 0; i < {}; i = i + 1) {{ "
+                       "var node = Node(); node.next = head; {}head = node; }} }}",
+                       instance_count, fields);
+}
+
+void instance_memory(Context& context) {
+    for (u32 field_count : { 3, 6 }) {
+        Script script(instance_list(field_count));
+        script::Interpreter interpreter;
+
+        context.measure_memory(fmt::format("instance_memory/fields_{}", field_count), instance_count, [&] {
+            script.run(interpreter);
+        });
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,78 @@
+#include "bench.hpp"
+
+#include <fmt/core.h>
+
+namespace bench {
+
+struct Workload {
+    const char* name;
+    const char* source;
+    u64 iterations;
+};
+
+// Each workload spends its time in one of the sequences the interpreter and the vm fuse: comparing a local with a
+// constant to decide whether to loop, incrementing a local by a constant and reading a property of a local.
+static const Workload workloads[] = {
+    { "counting", R"(
+{
+    var count = 0;
+    for (var i = 0; i < 1000000; i = i + 1) {
+        count = count + 1;
+    }
+}
+)",
+      1000000 },
+    { "countdown", R"(
+{
+    var n = 1000000;
+    while (n > 0) n = n - 1;
+}
+)",
+      1000000 },
+    { "branches", R"(
+{
+    var small = 0;
+    var large = 0;
+    for (var i = 0; i < 1000000; i = i + 1) {
+        if (i < 500000) small = small + 1; else large = large + 1;
+    }
+}
+)",
+      1000000 },
+    { "field_sum", R"(
+class Point {}
+{
+    var point = Point();
+    point.x = 1;
+    point.y = 2;
+    var sum = 0;
+    for (var i = 0; i < 100000; i = i + 1) {
+        sum = sum + point.x * point.y;
+    }
+}
+)",
+      100000 },
+};
+
+// Reports the time per loop iteration with and without fused sequences, on both the interpreter and the vm.
+void loops(Context& context) {
+    for (auto& workload : workloads) {
+        for (bool fusion : { true, false }) {
+            Script script(workload.source, fusion);
+            const char* variant = fusion ? "" : "_unfused";
+
+            script::Interpreter interpreter;
+            context.measure(fmt::format("loops/ast{}/{}", variant, workload.name), workload.iterations, [&] {
+                script.run(interpreter);
+            });
+
+            script::VM vm;
+            auto functions = script.compile(vm);
+            context.measure(fmt::format("loops/vm{}/{}", variant, workload.name), workload.iterations, [&] {
+                script.run(vm, functions);
+            });
+        }
+    }
+}
+
+} // namespace bench
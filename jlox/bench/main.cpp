@@ -0,0 +1,217 @@
+#include "bench.hpp"
+
+#include "script/compiler.hpp"
+#include "script/resolver.hpp"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <fmt/core.h>
+
+#ifndef JLOX_BUILD_TYPE
+#define JLOX_BUILD_TYPE ""
+#endif
+
+static u64 allocations = 0;
+static u64 allocation_bytes = 0;
+
+void* operator new(usize size) {
+    allocations++;
+    allocation_bytes += size;
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](usize size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, usize) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, usize) noexcept {
+    std::free(memory);
+}
+
+namespace bench {
+
+static const Benchmark benchmarks[] = {
+    { "lex", lex },
+    { "parse", parse },
+    { "resolve", resolve },
+    { "execute", execute },
+    { "dispatch", dispatch },
+    { "loops", loops },
+    { "variable_access", variable_access },
+    { "instance_memory", instance_memory },
+    { "gc", gc },
+};
+
+u64 allocation_count() {
+    return allocations;
+}
+
+u64 allocated_bytes() {
+    return allocation_bytes;
+}
+
+Context::Context(const std::string& filter)
+    : _filter(filter) {
+}
+
+bool Context::selected(const std::string& name) const {
+    return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+Context::Sample Context::run(const std::function<void()>& body) {
+    using clock = std::chrono::steady_clock;
+
+    // One untimed call to warm up caches and allocators.
+    body();
+
+    Sample sample{ 0, 0, allocations };
+    auto start = clock::now();
+    while (sample.elapsed_ns < min_time_ns) {
+        body();
+        sample.iterations++;
+        sample.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+    }
+    sample.allocations = allocations - sample.allocations;
+
+    return sample;
+}
+
+void Context::measure(const std::string& name, u64 ops, const std::function<void()>& body) {
+    if (!selected(name))
+        return;
+
+    auto sample = run(body);
+
+    f64 count = static_cast<f64>(sample.iterations * ops);
+    std::cout << fmt::format("{:<40} {:>14.2f} ns/op {:>14.2f} allocs/op {:>8} iterations\n", name,
+                             sample.elapsed_ns / count, sample.allocations / count, sample.iterations);
+}
+
+void Context::measure_throughput(const std::string& name, u64 bytes, const std::function<void()>& body) {
+    if (!selected(name))
+        return;
+
+    auto sample = run(body);
+
+    f64 mb_per_second = static_cast<f64>(bytes * sample.iterations) / 1e6 / (sample.elapsed_ns / 1e9);
+    std::cout << fmt::format("{:<40} {:>14.2f} MB/s  {:>14.2f} allocs/op {:>8} iterations\n", name, mb_per_second,
+                             static_cast<f64>(sample.allocations) / sample.iterations, sample.iterations);
+}
+
+void Context::measure_memory(const std::string& name, u64 objects, const std::function<void()>& body) {
+    if (!selected(name))
+        return;
+
+    body();
+
+    u64 bytes = allocation_bytes;
+    u64 count = allocations;
+    body();
+
+    f64 per_object = static_cast<f64>(objects);
+    std::cout << fmt::format("{:<40} {:>14.2f} bytes/op {:>11.2f} allocs/op\n", name,
+                             (allocation_bytes - bytes) / per_object, (allocations - count) / per_object);
+}
+
+Script::Script(const std::string& source, bool fusion)
+    : _fusion(fusion) {
+    script::Parser parser(create_box<script::Source>(source));
+    _program = parser.parse();
+    if (parser.error())
+        throw std::runtime_error("benchmark script failed to parse");
+
+    script::Resolver resolver;
+    resolver.set_fusion(fusion);
+    resolver.run(_program->statements);
+    if (resolver.error())
+        throw std::runtime_error("benchmark script failed to resolve");
+}
+
+std::vector<script::Node::ptr>& Script::statements() {
+    return _program->statements;
+}
+
+void Script::run(script::Interpreter& interpreter) {
+    for (auto& stmt : _program->statements) {
+        interpreter.interpret(stmt.get());
+    }
+}
+
+std::vector<Arc<script::FunctionProto>> Script::compile(script::VM& vm, bool registers) {
+    std::vector<Arc<script::FunctionProto>> functions;
+
+    for (auto& stmt : _program->statements) {
+        script::Compiler compiler(&vm);
+        compiler.set_registers(registers);
+        compiler.set_fusion(_fusion);
+        functions.push_back(compiler.compile(stmt.get()));
+        if (compiler.error())
+            throw std::runtime_error("benchmark script failed to compile");
+    }
+
+    return functions;
+}
+
+void Script::run(script::VM& vm, std::vector<Arc<script::FunctionProto>>& functions) {
+    for (auto& function : functions) {
+        vm.interpret(function);
+    }
+}
+
+} // namespace bench
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        std::cerr << "./jlox_bench [filter]\n";
+        return 1;
+    }
+
+    std::string build_type = JLOX_BUILD_TYPE;
+#ifdef JLOX_COMPUTED_GOTO
+    const char* dispatch = "computed goto";
+#else
+    const char* dispatch = "switch";
+#endif
+    std::cout << fmt::format("jlox_bench, {} build, {} dispatch\n", build_type.empty() ? "unknown" : build_type,
+                             dispatch);
+    if (build_type != "Release")
+        std::cout << "warning: numbers from a non Release build are not comparable\n";
+
+    bench::Context context(argc > 1 ? argv[1] : "");
+
+    for (auto& benchmark : bench::benchmarks) {
+        benchmark.function(context);
+    }
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << fmt::format("peak rss: {} KiB\n", usage.ru_maxrss);
+
+    auto& stats = script::Heap::instance().stats();
+    std::cout << fmt::format("gc minor: {} collections, {} objects promoted, {:.2f} ms total pause, "
+                             "{:.3f} ms max pause\n",
+                             stats.minor_collections, stats.objects_promoted, stats.minor_total_pause_ns / 1e6,
+                             stats.minor_max_pause_ns / 1e6);
+    std::cout << fmt::format("gc major: {} collections, {} objects freed, {:.2f} ms total pause, {:.3f} ms max pause\n",
+                             stats.collections, stats.objects_freed, stats.total_pause_ns / 1e6,
+                             stats.max_pause_ns / 1e6);
+}
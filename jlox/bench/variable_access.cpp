@@ -0,0 +1,47 @@
+#include "bench.hpp"
+
+#include "script/interpreter.hpp"
+
+#include <fmt/core.h>
+
+namespace bench {
+
+static constexpr u32 loop_count = 10000;
+
+// Every iteration reads `a` eight times, writes `sum`, reads `i` twice and writes it once.
+static constexpr u32 accesses_per_iteration = 12;
+
+static std::string access_loop(u32 extra_depth) {
+    std::string open;
+    std::string close;
+    for (u32 i = 0; i < extra_depth; i++) {
+        open += "{ ";
+        close += "} ";
+    }
+
+    return fmt::format("{{ var a = 1; var sum = 0; var i = 0; {}"
+                       "while (i < {}) {{ sum = a + a + a + a + a + a + a + a; i = i + 1; }} {}}}",
+                       open, loop_count, close);
+}
+
+void variable_access(Context& context) {
+    for (u32 depth : { 0, 3 }) {
+        Script script(access_loop(depth));
+        script::Interpreter interpreter;
+
+        context.measure(fmt::format("variable_access/local_depth_{}", depth), loop_count * accesses_per_iteration, [&] {
+            script.run(interpreter);
+        });
+    }
+
+    Script script(fmt::format("var a = 1; var sum = 0; var i = 0;"
+                              "while (i < {}) {{ sum = a + a + a + a + a + a + a + a; i = i + 1; }}",
+                              loop_count));
+    script::Interpreter interpreter;
+
+    context.measure("variable_access/global", loop_count * accesses_per_iteration, [&] {
+        script.run(interpreter);
+    });
+}
+
+} // namespace bench
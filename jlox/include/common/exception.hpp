@@ -35,6 +35,20 @@ private:
     std::string _message;
 };
 
+class CompileError : public std::exception {
+public:
+    CompileError(const std::string& message)
+        : _message(message) {
+    }
+
+    const char* what() const noexcept override {
+        return _message.data();
+    }
+
+private:
+    std::string _message;
+};
+
 class RuntimeError : public std::exception {
 public:
     RuntimeError(const script::Token& token, const std::string& message)
@@ -1,23 +1,26 @@
 #pragma once
 
-#include <functional>
+#include <utility>
 
 namespace oso {
 
+// Holds the action by value instead of in a std::function, so deferring a lambda never allocates.
+template <typename F>
 class finally {
 public:
-    using final_action_type = std::function<void()>;
-
-    finally(final_action_type final_action) {
-        _final_action = final_action;
+    explicit finally(F final_action)
+        : _final_action(std::move(final_action)) {
     }
 
+    finally(const finally&) = delete;
+    finally& operator=(const finally&) = delete;
+
     ~finally() {
         _final_action();
     }
 
 private:
-    final_action_type _final_action;
+    F _final_action;
 };
 
 } // namespace oso
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common/common.hpp"
+
+#include <new>
+#include <vector>
+
+namespace script {
+
+// A bump allocator. Memory is handed out from large blocks and only given back all at once when the arena is
+// destroyed, so nothing allocated from it may outlive it. Destructors are not run by the arena.
+class Arena {
+public:
+    static constexpr usize block_size = 64 * 1024;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(usize size, usize alignment);
+
+    template<typename T, typename... TArgs>
+    T* create(TArgs&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+    }
+
+    usize bytes_allocated() const;
+    usize block_count() const;
+
+private:
+    std::vector<Box<u8[]>> _blocks;
+    u8* _cursor = nullptr;
+    u8* _end = nullptr;
+    usize _bytes_allocated = 0;
+};
+
+} // namespace script
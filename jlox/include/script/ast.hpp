@@ -4,10 +4,13 @@
 #include <variant>
 #include <vector>
 
+#include "arena.hpp"
+#include "source.hpp"
 #include "token.hpp"
 
 namespace script {
 
+struct Node;
 struct UnaryExpr;
 struct BinaryExpr;
 struct GroupingExpr;
@@ -31,6 +34,62 @@ struct FunctionStmt;
 struct ReturnStmt;
 struct ClassStmt;
 
+// Where the resolver found a variable. Globals are looked up by name, locals live in a slot of the current call frame
+// and variables of enclosing functions are reached through the upvalue at `slot` of the running function.
+struct VariableLocation {
+    enum Kind : u8 {
+        Global,
+        Local,
+        Upvalue,
+    };
+
+    Kind kind = Global;
+    u16 slot = 0;
+};
+
+// A variable a function captures when it is created, either a slot of the enclosing frame or an upvalue of the
+// enclosing function.
+struct CapturedVariable {
+    u16 index;
+    bool is_local;
+};
+
+// Sequences of nodes the resolver found that the interpreter runs as one operation instead of visiting each node. The
+// interpreter falls back to visiting the nodes when the local doesn't hold what the fused operation expects.
+enum class Fusion : u8 {
+    None,
+    // a binary expression of a local and a number literal, or a condition that is one
+    LocalNumber,
+    // an assignment of a local plus a number literal to the same local
+    LocalIncrement,
+    // a property of the instance in a local
+    LocalProperty,
+};
+
+class Shape;
+
+// The shapes a property access has seen and the slot of the property in each of them, a store that adds the property
+// also remembers the shape the instance moves to. Sites that see more than max_entries shapes stop caching.
+struct InlineCache {
+    static constexpr u32 max_entries = 4;
+
+    struct Entry {
+        Shape* shape;
+        Shape* transition;
+        u32 slot;
+    };
+
+    Entry entries[max_entries];
+    u32 size = 0;
+    u64 hits = 0;
+    u64 misses = 0;
+};
+
+// Nodes live in the arena of the program they were parsed into, releasing a node only runs its destructor.
+struct NodeDeleter {
+    void operator()(Node* node) const;
+};
+
 class Visitor {
 public:
     virtual void visit_print_stmt(PrintStmt* stmt) = 0;
@@ -58,7 +117,7 @@ public:
 };
 
 struct Node {
-    using ptr = std::unique_ptr<Node>;
+    using ptr = std::unique_ptr<Node, NodeDeleter>;
 
     enum Type {
         UnaryExpr,
@@ -118,6 +177,11 @@ struct BinaryExpr : Expr {
     Token op;
     Node::ptr left;
     Node::ptr right;
+
+    // the local and the number of a fused expression
+    Fusion fusion = Fusion::None;
+    u16 slot = 0;
+    f64 number = 0;
 };
 
 struct GroupingExpr : Expr {
@@ -142,7 +206,7 @@ struct LiteralExpr : Expr {
     }
 
     LiteralType literal_type;
-    std::variant<bool, f64, std::string> value;
+    std::variant<bool, f64, ScriptString*> value;
 };
 
 struct LogicalExpr : Expr {
@@ -180,6 +244,7 @@ struct VariableExpr : Expr {
     }
 
     Token name;
+    VariableLocation location;
 };
 
 struct AssignmentExpr : Expr {
@@ -192,6 +257,8 @@ struct AssignmentExpr : Expr {
 
     Token name;
     Node::ptr value;
+    VariableLocation location;
+    Fusion fusion = Fusion::None;
 };
 
 struct CallExpr : Expr {
@@ -217,6 +284,11 @@ struct GetExpr : Expr {
 
     Node::ptr object;
     Token name;
+    InlineCache cache;
+
+    // the local of the instance of a fused access
+    Fusion fusion = Fusion::None;
+    u16 slot = 0;
 };
 
 struct SetExpr : Expr {
@@ -230,10 +302,11 @@ struct SetExpr : Expr {
     Node::ptr object;
     Token name;
     Node::ptr value;
+    InlineCache cache;
 };
 
 struct Stmt : public Node {
-    using ptr = std::unique_ptr<Stmt>;
+    using ptr = std::unique_ptr<Stmt, NodeDeleter>;
 
     virtual ~Stmt() = default;
     virtual void accept(Visitor* visitor) = 0;
@@ -271,6 +344,8 @@ struct VarStmt : Stmt {
 
     Token name;
     Node::ptr initializer;
+
+    VariableLocation location;
 };
 
 struct BlockStmt : Stmt {
@@ -282,6 +357,12 @@ struct BlockStmt : Stmt {
     }
 
     std::vector<Node::ptr> statements;
+
+    // first frame slot of the variables declared in this block and whether a closure captured any of them, those are
+    // closed when the block ends. Blocks at the top level are not part of a function and own a frame of frame_size slots.
+    u32 first_slot;
+    bool closes_upvalues;
+    u32 frame_size;
 };
 
 struct IfStmt : Stmt {
@@ -295,6 +376,7 @@ struct IfStmt : Stmt {
     Expr::ptr condition;
     Stmt::ptr then_branch;
     Stmt::ptr else_branch;
+    Fusion fusion = Fusion::None;
 };
 
 struct WhileStmt : Stmt {
@@ -307,6 +389,7 @@ struct WhileStmt : Stmt {
 
     Expr::ptr condition;
     Stmt::ptr body;
+    Fusion fusion = Fusion::None;
 };
 
 struct BreakStmt : Stmt {
@@ -329,6 +412,12 @@ struct FunctionStmt : Stmt {
     Token name;
     std::vector<Token> params;
     std::vector<Node::ptr> body;
+
+    // where the function name is declared (unused for anonymous functions), the number of slots its call frame needs
+    // and the variables of enclosing functions it uses
+    VariableLocation location;
+    u32 frame_size;
+    std::vector<CapturedVariable> upvalues;
 };
 
 struct ReturnStmt : Stmt {
@@ -353,6 +442,16 @@ struct ClassStmt : Stmt {
 
     Token name;
     std::vector<Node::ptr> functions;
+
+    VariableLocation location;
+};
+
+// The result of parsing a script. Every node of the tree is allocated from the arena and tokens refer to the source, so
+// the program has to outlive anything that still points into it, e.g. functions keep a pointer to their declaration.
+struct Program {
+    Box<Source> source;
+    Arena arena;
+    std::vector<Node::ptr> statements;
 };
 
 } // namespace script
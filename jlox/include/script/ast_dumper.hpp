@@ -38,7 +38,7 @@ private:
     std::string buffer;
 
     void write(const std::string& str, bool indentation = false, bool newline = false);
-    void write_str_field(const std::string& field, const std::string& value);
+    void write_str_field(const std::string& field, std::string_view value);
     void write_int_field(const std::string& field, const i32 value);
     void write_double_field(const std::string& field, const f64 value);
     void write_node(const std::string& name, Node* node);
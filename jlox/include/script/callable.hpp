@@ -12,22 +12,23 @@ enum ScriptCallableType : u8 {
     Invalid,
     Builtin,
     Function,
+    Closure,
 };
 
 class Interpreter;
 
-struct ScriptCallable {
+struct ScriptCallable : ScriptHeapObject {
     using function_type = std::function<ScriptObject(Interpreter* interpreter, std::vector<ScriptObject>& arguments)>;
 
-    u8 type;
+    u8 callable_type;
     u16 arity;
     function_type function;
 
-    ScriptCallable();
+    ScriptCallable(u8 object_type = ScriptObjectType::Callable);
     ScriptCallable(u16 arity, function_type& function);
 
     virtual ScriptObject call(Interpreter* interpreter, std::vector<ScriptObject>& arguments);
-    virtual std::string to_string();
+    std::string to_string() override;
 };
 
 } // namespace script
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "common/common.hpp"
+#include "script/object.hpp"
+
+#include <string>
+#include <vector>
+
+namespace script {
+
+enum OpCode : u8 {
+    OP_CONSTANT,
+    OP_NIL,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+
+    // Variables.
+    OP_GET_LOCAL,
+    OP_SET_LOCAL,
+    OP_GET_GLOBAL,
+    OP_DEFINE_GLOBAL,
+    OP_SET_GLOBAL,
+    OP_GET_UPVALUE,
+    OP_SET_UPVALUE,
+    OP_GET_PROPERTY,
+    OP_SET_PROPERTY,
+
+    // Operators.
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_NOT,
+    OP_NEGATE,
+
+    // Statements and control flow.
+    OP_PRINT,
+    OP_JUMP,
+    OP_JUMP_IF_FALSE,
+    OP_JUMP_IF_TRUE,
+    OP_LOOP,
+    OP_CALL,
+    OP_CLOSURE,
+    OP_CLOSE_UPVALUE,
+    OP_RETURN,
+    OP_CLASS,
+
+    // Register instructions, Lua style: `A B C` computes RK(B) op RK(C) into register A of the frame. The result is a
+    // temporary that becomes the top of the stack.
+    OP_ADD_RK,
+    OP_SUBTRACT_RK,
+    OP_MULTIPLY_RK,
+    OP_DIVIDE_RK,
+    OP_EQUAL_RK,
+    OP_NOT_EQUAL_RK,
+    OP_GREATER_RK,
+    OP_GREATER_EQUAL_RK,
+    OP_LESS_RK,
+    OP_LESS_EQUAL_RK,
+
+    // Same, but A is a local that is assigned and the stack stays as it is.
+    OP_ADD_RK_STORE,
+    OP_SUBTRACT_RK_STORE,
+    OP_MULTIPLY_RK_STORE,
+    OP_DIVIDE_RK_STORE,
+
+    // Quickened forms of the adaptive instructions for sites that only saw numbers so far. If an operand isn't a
+    // number the site is rewritten back to the generic instruction.
+    OP_ADD_NUM_RK,
+    OP_EQUAL_NUM_RK,
+    OP_NOT_EQUAL_NUM_RK,
+    OP_ADD_NUM_RK_STORE,
+
+    // Superinstructions for sequences loops run on every iteration. A test compares two RK operands and jumps forward
+    // by its u16 offset unless the comparison holds, it leaves nothing on the stack. OP_GET_LOCAL_PROPERTY pushes the
+    // property named by its u16 constant of the instance in the local of its first operand.
+    OP_TEST_GREATER,
+    OP_TEST_GREATER_EQUAL,
+    OP_TEST_LESS,
+    OP_TEST_LESS_EQUAL,
+    OP_GET_LOCAL_PROPERTY,
+
+    // number of opcodes, not an instruction
+    OP_COUNT,
+};
+
+// An RK operand is a register of the frame, or the constant `operand & ~rk_constant` of the chunk if the top bit is
+// set.
+static constexpr u8 rk_constant = 0x80;
+
+// Adaptive instructions, the register forms of operators that take more than numbers, rewrite themselves to their
+// quickened form once they see numbers. Their last operand counts how often the quickened form had to fall back, a site
+// that did so `max_deopts` times stays generic.
+static constexpr u8 max_deopts = 4;
+
+// whether `op` is an adaptive instruction, generic or quickened
+bool is_adaptive(u8 op);
+
+struct FunctionProto;
+
+// A compiled sequence of instructions. Operands are encoded inline after the opcode, 16 bit operands are stored
+// big endian.
+struct Chunk {
+    std::vector<u8> code;
+    std::vector<u32> lines;
+    std::vector<ScriptObject> constants;
+    std::vector<Arc<FunctionProto>> functions;
+    // offsets of the adaptive instructions
+    std::vector<usize> adaptive_sites;
+
+    void write(u8 byte, u32 line);
+    usize add_constant(const ScriptObject& value);
+    usize add_function(Arc<FunctionProto> function);
+
+    void disassemble(const std::string& name);
+    usize disassemble_instruction(usize offset);
+
+    // Prints the state of every adaptive instruction of the chunk and of the functions in it.
+    void print_quickening_stats(const std::string& name);
+};
+
+struct FunctionProto {
+    std::string name;
+    u16 arity;
+    u16 upvalue_count;
+    Chunk chunk;
+
+    FunctionProto(const std::string& name);
+
+    // marks the constants of the function and of every function nested in it
+    void trace(Heap& heap);
+};
+
+} // namespace script
@@ -4,9 +4,12 @@
 
 namespace script {
 
-struct ScriptClass : ScriptCallable, public std::enable_shared_from_this<ScriptClass>  {
+struct ScriptClass : ScriptCallable {
     std::string name;
 
+    // the most fields an instance of the class had so far, new instances reserve inline room for that many
+    u32 expected_fields;
+
     ScriptClass() = delete;
     ScriptClass(const std::string& name);
 
@@ -1,25 +1,56 @@
 #pragma once
 
 #include "script/object.hpp"
-#include "script/token.hpp"
-
-#include <unordered_map>
+#include "script/shape.hpp"
 
 namespace script {
 
 struct ScriptClass;
 
-struct ScriptClassInstance {
-    Arc<ScriptClass> klass;
-    std::unordered_map<std::string, ScriptObject> fields;
+// The shape maps field names to slots, the values of the first inline_capacity slots are stored right behind the
+// instance in the same allocation. The capacity is what instances of the class needed so far, fields added past it go
+// to an overflow array that grows to the next power of two. Instances start out in the nursery.
+struct ScriptClassInstance : ScriptHeapObject {
+    static constexpr u32 max_inline_capacity = 32;
+
+    ScriptClass* klass;
+    Shape* shape;
+    Box<ScriptObject[]> overflow;
+    u32 inline_capacity;
 
     ScriptClassInstance() = delete;
-    ScriptClassInstance(Arc<ScriptClass>& klass);
+    ~ScriptClassInstance() override;
+
+    static ScriptObject create(ScriptClass* klass);
+
+    // instances are allocated together with their inline fields
+    static void operator delete(void* memory);
+
+    ScriptObject& field(u32 slot) {
+        if (slot < inline_capacity)
+            return inline_fields()[slot];
+        return overflow[slot - inline_capacity];
+    }
+
+    ScriptObject* find_field(ScriptString* name);
+
+    // returns the slot of the field, adding it moves the instance to a new shape
+    u32 set(ScriptString* name, ScriptObject value);
+
+    // stores the field that `next` adds to the current shape
+    void add_field(Shape* next, ScriptObject value);
+
+    void trace(Heap& heap) override;
+    ScriptHeapObject* relocate() override;
+    bool owns_memory() const override;
+    std::string to_string() override;
 
-    ScriptObject& get(Token& name);
-    void set(Token& name, ScriptObject value);
+private:
+    ScriptClassInstance(ScriptClass* klass, u32 inline_capacity);
 
-    std::string to_string() const;
+    ScriptObject* inline_fields() {
+        return reinterpret_cast<ScriptObject*>(this + 1);
+    }
 };
 
 } // namespace script
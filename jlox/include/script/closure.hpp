@@ -0,0 +1,44 @@
+#pragma once
+
+#include "script/callable.hpp"
+#include "script/chunk.hpp"
+
+namespace script {
+
+// A variable captured by a closure. While the variable is still alive on the VM stack the upvalue is 'open' and
+// points into the stack, once the variable goes out of scope it is 'closed' and the value moves into the upvalue.
+struct ScriptUpvalue {
+    ScriptObject* location;
+    ScriptObject closed;
+    Arc<ScriptUpvalue> next;
+
+    // whether the heap remembers the upvalue for holding a young value
+    bool remembered;
+
+    ScriptUpvalue() = delete;
+    ScriptUpvalue(ScriptObject* location);
+};
+
+// The upvalues that are still open, sorted by the address of their variable from the top of the stack down. Closures
+// created for the same variable share one upvalue, closing a frame or scope only has to look at the head of the list.
+class OpenUpvalues {
+public:
+    Arc<ScriptUpvalue> capture(ScriptObject* local);
+    void close(ScriptObject* last);
+
+private:
+    Arc<ScriptUpvalue> _head;
+};
+
+struct ScriptClosure : ScriptCallable {
+    Arc<FunctionProto> proto;
+    std::vector<Arc<ScriptUpvalue>> upvalues;
+
+    ScriptClosure() = delete;
+    ScriptClosure(Arc<FunctionProto> proto);
+
+    void trace(Heap& heap) override;
+    std::string to_string() override;
+};
+
+} // namespace script
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "ast.hpp"
+#include "chunk.hpp"
+
+namespace script {
+
+class VM;
+
+// Lowers a resolved statement into bytecode for the VM. Every top level statement is compiled into its own script
+// function so runtime errors behave the same way they do in the tree walking interpreter.
+//
+// Slots of a call frame double as registers: locals keep the slot they are declared in and every value an expression
+// leaves on the stack is a temporary in the register above them. Binary operators read their operands straight from
+// the registers of locals, from constants or from the temporaries of nested expressions and write their result into a
+// register, instead of pushing every operand first.
+class Compiler : public Visitor {
+public:
+    Compiler(VM* vm);
+
+    Arc<FunctionProto> compile(Node* node);
+    bool error() const;
+
+    // Stack instructions only, for comparing against register instructions.
+    void set_registers(bool enabled);
+
+    // Without superinstructions every node is compiled on its own, for comparing against the fused sequences.
+    void set_fusion(bool enabled);
+
+    void visit_print_stmt(PrintStmt* stmt) override;
+    void visit_expr_stmt(ExprStmt* stmt) override;
+    void visit_var_stmt(VarStmt* stmt) override;
+    void visit_block_stmt(BlockStmt* stmt) override;
+    void visit_if_stmt(IfStmt* stmt) override;
+    void visit_while_stmt(WhileStmt* stmt) override;
+    void visit_break_stmt(BreakStmt* stmt) override;
+    void visit_function_stmt(FunctionStmt* stmt) override;
+    void visit_return_stmt(ReturnStmt* stmt) override;
+    void visit_class_stmt(ClassStmt* stmt) override;
+
+    void visit_unary_expr(UnaryExpr* node) override;
+    void visit_binary_expr(BinaryExpr* node) override;
+    void visit_grouping_expr(GroupingExpr* node) override;
+    void visit_literal_expr(LiteralExpr* node) override;
+    void visit_logical_expr(LogicalExpr* node) override;
+    void visit_conditional_expr(ConditionalExpr* node) override;
+    void visit_variable_expr(VariableExpr* node) override;
+    void visit_assignment_expr(AssignmentExpr* node) override;
+    void visit_call_expr(CallExpr* node) override;
+    void visit_get_expr(GetExpr* node) override;
+    void visit_set_expr(SetExpr* node) override;
+
+private:
+    // Locals sit in the slots the resolver gave them, one above its slot numbers as slot 0 holds the called function.
+    // The compiler only keeps track of when they go out of scope.
+    struct Local {
+        i32 depth;
+        bool captured;
+    };
+
+    struct Loop {
+        i32 scope_depth;
+        std::vector<usize> break_jumps;
+    };
+
+    struct FunctionState {
+        FunctionState* enclosing;
+        Arc<FunctionProto> function;
+        std::vector<Local> locals;
+        std::vector<Loop> loops;
+        i32 scope_depth;
+        // values above the locals that are still on the stack
+        u32 temporaries;
+    };
+
+    VM* _vm;
+    FunctionState* _state;
+    bool _error;
+    bool _registers;
+    bool _fusion;
+    u32 _line;
+
+    void throw_error(const std::string& error);
+
+    Chunk& current_chunk();
+
+    void compile_stmt(Node* node);
+    void compile_expr(Node* node);
+    void compile_expr_stmt(Node* expr);
+    void compile_function(FunctionStmt* stmt);
+
+    // Register instructions, false if the expression has no register form or its registers don't fit into operands.
+    bool compile_register_binary(BinaryExpr* node);
+    bool compile_register_store(AssignmentExpr* node);
+
+    // Compiles a comparison of two RK leaves into a test that jumps when it is false, `jump` is the offset to patch.
+    // False if the condition needs to be evaluated onto the stack.
+    bool compile_test(Node* condition, usize& jump);
+
+    // Constants and locals are read by the instruction itself, anything else is compiled into the next temporary.
+    // Locals are only read that way if `read_locals`, when nothing between here and the instruction can change them.
+    bool rk_leaf(Node* node, bool read_locals, u8& operand);
+    u8 rk_operand(Node* node, bool read_locals);
+    u32 next_register();
+
+    void emit_byte(u8 byte);
+    void emit_bytes(u8 a, u8 b);
+    void emit_u16(u16 value);
+    void emit_register_instruction(OpCode op, u8 a, u8 b, u8 c);
+    void emit_constant(const ScriptObject& value);
+    usize emit_jump(OpCode op);
+    void emit_loop(usize loop_start);
+    void patch_jump(usize offset);
+
+    u16 make_constant(const ScriptObject& value);
+    u16 identifier_constant(ScriptString* name);
+
+    void begin_scope();
+    void end_scope();
+    void discard_locals(i32 depth);
+
+    void add_local(const VariableLocation& location);
+    void define_variable(const Token& name, const VariableLocation& location);
+    void named_variable(Token& name, const VariableLocation& location, bool assign);
+};
+
+} // namespace script
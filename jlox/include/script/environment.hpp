@@ -4,34 +4,34 @@
 #include "callable.hpp"
 #include "object.hpp"
 
-#include <unordered_map>
+#include "script/string_table.hpp"
 
 namespace script {
 
+// Only globals live in an environment and are looked up by name, locals live in call frames on the interpreter's value
+// stack and closures reach them through upvalues.
 class ScriptEnvironment {
 public:
     ScriptEnvironment();
-    ScriptEnvironment(ScriptEnvironment* enclosing);
-
-    void set_name(const std::string& name);
 
     void assign_variable(const Token& name, ScriptObject& value);
-    void assign_variable_at(usize distance, const Token& name, ScriptObject& value);
-
-    void define_variable(const std::string& name, ScriptObject& value);
+    void define_variable(ScriptString* name, ScriptObject& value);
     void define_function(const std::string& name, u16 arity, ScriptCallable::function_type& function);
 
     ScriptObject& find_variable(const Token& name);
-    ScriptObject& find_variable_at(usize distance, const Token& name);
+
+    void mark(Heap& heap);
 
     void print(u32 indent);
 
 private:
-    std::string _name;
-    ScriptEnvironment* _enclosing;
-    std::unordered_map<std::string, ScriptObject> _variables;
+    InternedMap<ScriptObject> _variables;
+
+    // variables that were given a young value since the last minor collection, the others are only visited by major
+    // collections
+    std::vector<ScriptObject*> _young_variables;
 
-    ScriptEnvironment* get_ancestor(usize distance);
+    void write_barrier(ScriptObject& variable);
 };
 
 } // namespace script
@@ -2,20 +2,20 @@
 
 #include "script/ast.hpp"
 #include "script/callable.hpp"
+#include "script/closure.hpp"
 
 namespace script {
 
-class ScriptEnvironment;
-
 struct ScriptFunction : ScriptCallable {
     FunctionStmt* decl;
-    Arc<ScriptEnvironment> closure;
+    std::vector<Arc<ScriptUpvalue>> upvalues;
     bool anonymous;
 
     ScriptFunction() = delete;
-    ScriptFunction(FunctionStmt* decl, Arc<ScriptEnvironment> closure, bool anonymous);
+    ScriptFunction(FunctionStmt* decl, bool anonymous);
 
     ScriptObject call(Interpreter* interpreter, std::vector<ScriptObject>& arguments) override;
+    void trace(Heap& heap) override;
     std::string to_string() override;
 };
 
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "common/common.hpp"
+
+#include <vector>
+
+namespace script {
+
+struct ScriptHeapObject;
+struct ScriptUpvalue;
+class ScriptObject;
+class Heap;
+
+// Anything that references heap objects from outside of the heap, like the value stack of an interpreter. Root sets
+// add themselves to the heap once they are constructed and remove themselves before they are destroyed.
+class RootSet {
+public:
+    virtual ~RootSet() = default;
+
+    virtual void mark_roots(Heap& heap) = 0;
+};
+
+// Every time the collector interrupted the script. Bucket 0 counts pauses below 1 us, bucket i > 0 pauses from 2^(i-1)
+// up to 2^i us, the last bucket everything longer.
+struct PauseHistogram {
+    static constexpr usize bucket_count = 20;
+
+    u64 buckets[bucket_count] = {};
+
+    void record(u64 pause_ns);
+
+    // upper bound of bucket i in microseconds
+    static u64 bucket_limit_us(usize bucket);
+};
+
+struct GcStats {
+    u64 collections = 0;
+    u64 slices = 0;
+    u64 objects_freed = 0;
+    u64 bytes_freed = 0;
+    u64 total_pause_ns = 0;
+    u64 max_pause_ns = 0;
+
+    u64 minor_collections = 0;
+    u64 objects_promoted = 0;
+    u64 bytes_promoted = 0;
+    u64 minor_total_pause_ns = 0;
+    u64 minor_max_pause_ns = 0;
+
+    PauseHistogram pauses;
+};
+
+// Generational collector that owns every ScriptHeapObject.
+//
+// Strings and instances are bump allocated in a fixed size nursery. When it is full a minor collection moves the young
+// objects that are reachable from the roots or from the remembered set into the old generation and leaves a forwarding
+// stub behind, the nursery is then reused from the start. Dead young objects are never visited unless they own memory
+// that their destructor frees.
+//
+// Everything else is allocated old. Once the old generation has doubled since the last cycle it is collected with
+// incremental tri-color mark-sweep: marking and sweeping run in slices of at most the pause target, one slice every
+// `slice_interval` bytes the script allocates. Marking ends with an atomic step that empties the nursery, marks the
+// roots again and drains the gray objects. Objects allocated while a cycle runs start out marked.
+//
+// Old objects that get a reference to another object have to go through a write barrier. It remembers old objects
+// that reference young ones for minor collections, and while marking it grays the stored object so a marked object
+// never hides an unmarked one.
+class Heap {
+public:
+    static constexpr usize nursery_size = 256 * 1024;
+    static constexpr usize initial_threshold = 1024 * 1024;
+    static constexpr usize growth_factor = 2;
+    static constexpr usize slice_interval = 64 * 1024;
+    static constexpr u64 default_pause_target_ns = 1'000'000;
+
+    // The heap is never destroyed, objects that are still alive at exit are left to the operating system.
+    static Heap& instance();
+
+    // Old allocations: called before the object is constructed, may run a slice of the current cycle.
+    void prepare_allocation(usize size);
+
+    // Memory for a young object, from the nursery unless it is full and can't be collected right now.
+    void* allocate_young(usize size);
+
+    ScriptHeapObject* track(ScriptHeapObject* object, usize size);
+
+    bool is_young(const ScriptHeapObject* object) const {
+        return reinterpret_cast<uintptr_t>(object) - reinterpret_cast<uintptr_t>(_nursery) < nursery_size;
+    }
+
+    bool is_young(const ScriptObject& value) const;
+
+    bool collecting_young() const {
+        return _collecting_young;
+    }
+
+    // Visits a reference during a collection. Minor collections move young objects and update the reference.
+    void mark(ScriptObject& value);
+    void mark(ScriptHeapObject* object);
+
+    // `owner` now references `value`.
+    void write_barrier(ScriptHeapObject* owner, const ScriptObject& value);
+
+    // The closed over value of the upvalue was changed.
+    void write_barrier(const Arc<ScriptUpvalue>& upvalue);
+
+    // Young objects whose destructor has work to do, like freeing the overflow fields of an instance.
+    void add_finalizer(ScriptHeapObject* object);
+
+    // Finishes the running cycle and runs a full one without pausing in between.
+    void collect();
+    void collect_young();
+
+    // Longest time a slice of a major cycle may take, 0 collects the old generation in one go.
+    void set_pause_target(u64 pause_ns);
+    u64 pause_target() const;
+
+    void add_roots(RootSet* roots);
+    void remove_roots(RootSet* roots);
+
+    const GcStats& stats() const;
+    usize bytes_allocated() const;
+    void print_stats();
+
+    // Keeps the heap from collecting while objects are reachable only from places no root set knows about yet, e.g.
+    // constants of a function that is still being compiled. Young objects created in the scope are allocated old.
+    class NoCollection {
+    public:
+        NoCollection();
+        ~NoCollection();
+
+        NoCollection(const NoCollection&) = delete;
+        NoCollection& operator=(const NoCollection&) = delete;
+    };
+
+private:
+    enum class Phase : u8 {
+        Idle,
+        Marking,
+        Sweeping,
+    };
+
+    Heap();
+
+    u8* _nursery;
+    u8* _nursery_top;
+
+    std::vector<ScriptHeapObject*> _objects;
+    std::vector<ScriptHeapObject*> _gray;
+    std::vector<ScriptHeapObject*> _promoted;
+    std::vector<RootSet*> _roots;
+
+    std::vector<ScriptHeapObject*> _finalizers;
+    std::vector<ScriptHeapObject*> _remembered;
+    std::vector<Arc<ScriptUpvalue>> _remembered_upvalues;
+
+    Phase _phase = Phase::Idle;
+    usize _sweep_cursor = 0;
+    usize _sweep_live = 0;
+
+    usize _bytes_allocated = 0;
+    usize _next_collection = initial_threshold;
+    usize _allocated_since_slice = 0;
+    u64 _pause_target_ns = default_pause_target_ns;
+    u32 _no_collection = 0;
+    bool _collecting_young = false;
+
+    GcStats _stats;
+
+    bool slice_due() const;
+    void step();
+    void mark_roots();
+    bool mark_slice(u64 start_ns);
+    void finish_marking();
+    bool sweep_slice(u64 start_ns);
+    void finish_cycle();
+    bool out_of_time(u64 start_ns) const;
+
+    // newly old objects have to be marked if a cycle is running
+    void allocated_old(ScriptHeapObject* object);
+    ScriptHeapObject* promote(ScriptHeapObject* object);
+    void reset_nursery();
+    void record_pause(u64 start_ns);
+};
+
+} // namespace script
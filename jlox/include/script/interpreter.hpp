@@ -1,22 +1,25 @@
 #pragma once
 
 #include "ast.hpp"
+#include "closure.hpp"
 #include "environment.hpp"
 
 namespace script {
 
+struct ScriptFunction;
+
 enum class ControlFlowState {
     None,
     Break,
     Return,
 };
 
-class Interpreter : public Visitor {
+class Interpreter : public Visitor, public RootSet {
 public:
     Interpreter();
+    ~Interpreter() override;
 
     void interpret(Node* node);
-    void resolve(Expr* expr, usize depth);
 
     void visit_print_stmt(PrintStmt* stmt) override;
     void visit_expr_stmt(ExprStmt* stmt) override;
@@ -46,25 +49,72 @@ public:
     ControlFlowState control_flow_state();
     void set_control_flow_state(ControlFlowState state);
 
-    ScriptObject& expr_result();
+    // The callee and its arguments are the top arg_count + 1 values of the stack, the arguments become the first slots
+    // of the function's frame. All of them are popped when the call returns.
+    ScriptObject call_function(ScriptFunction* function, u8 arg_count);
+    void push(const ScriptObject& value) {
+        if (_stack_top == _stack_end) [[unlikely]]
+            stack_overflow();
+
+        *_stack_top++ = value;
+    }
+
+    void mark_roots(Heap& heap) override;
+
+    void print_inline_cache_stats();
+
+    // Collector statistics, pauses of both minor and major collections are in the histogram.
+    const GcStats& gc_stats() const;
 
-    void execute_block(std::vector<Node::ptr>& statements, std::shared_ptr<ScriptEnvironment> environment);
+    // Longest pause a slice of a major collection should take, 0 collects the old generation without pausing.
+    void set_gc_pause_target(u64 microseconds);
 
 private:
-    ScriptEnvironment _global_env;
-    ScriptEnvironment* _current_env;
-    ScriptObject _expr_result;
+    // number of slots on the value stack shared by the frames of all active calls and the temporaries of expressions
+    static constexpr usize stack_size = 64 * 1024;
+
+    // Calls recurse on the native stack, deeper calls fail with a runtime error before its 8 MB run out. Frames of
+    // builds with address sanitizer are several times larger.
+#ifdef __SANITIZE_ADDRESS__
+    static constexpr usize max_call_depth = 1024;
+#else
+    static constexpr usize max_call_depth = 4 * 1024;
+#endif
+
+    Arc<ScriptEnvironment> _global_env;
     ControlFlowState _control_flow_state;
-    std::unordered_map<Expr*, usize> _locals;
+
+    Box<ScriptObject[]> _stack;
+    ScriptObject* _stack_top;
+    ScriptObject* _stack_end;
+    ScriptObject* _frame;
+    ScriptFunction* _function;
+    usize _call_depth;
+    OpenUpvalues _open_upvalues;
+
+    // every property access site that ran so far, for the cache statistics
+    struct PropertySite {
+        Token* name;
+        bool store;
+        InlineCache* cache;
+    };
+
+    std::vector<PropertySite> _property_sites;
 
     // TODO: change places that use Node for type when Expr should be explicitly stated
     ScriptObject evaluate(Node* expr);
     void execute(Stmt* stmt);
-    void push_variable(u8 type, ScriptObject& value);
-    ScriptObject lookup_variable(Token& name, Expr* expr);
-
-    bool is_true(ScriptObject object);
-    bool is_equal(ScriptObject a, ScriptObject b);
+    bool condition_holds(Node* condition, Fusion fusion);
+    void execute_statements(std::vector<Node::ptr>& statements);
+    void pop_frame(ScriptObject* frame);
+    ScriptObject pop() {
+        return *--_stack_top;
+    }
+
+    [[noreturn]] void stack_overflow();
+    void define_variable(Token& name, VariableLocation location, ScriptObject& value);
+    ScriptObject lookup_variable(Token& name, VariableLocation location);
+    void record_cache_miss(InlineCache& cache, Token& name, bool store);
 
     void assert_object_type(Token& op, ScriptObjectType type, ScriptObject& object);
     void assert_objects_type(Token& op, ScriptObjectType type, ScriptObject& a, ScriptObject& b);
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "token.hpp"
-#include <string>
+#include <string_view>
 
 namespace script {
 
@@ -9,26 +9,28 @@ class Lexer {
 public:
     using ptr = std::unique_ptr<Lexer>;
 
-    Lexer(const std::string& buffer);
+    // The lexer does not copy the source, tokens refer to it and must not outlive it.
+    Lexer(std::string_view buffer);
 
     void print();
     Token next();
 
 private:
-    std::string _buffer;
+    std::string_view _buffer;
     usize _buffer_size;
 
     bool _error;
-    u32 _start;
-    u32 _current;
+    usize _start;
+    usize _current;
     u32 _line;
-    u32 _column;
+    // Offset of the first character of the current line, columns are only computed for error messages.
+    usize _line_start;
 
     void error(const std::string& msg);
+    void skip_whitespace();
 
     bool is_digit(char c) const;
     bool is_alpha(char c) const;
-    bool is_alphanumeric(char c) const;
     bool is_eof() const;
 
     char advance();
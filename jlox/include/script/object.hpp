@@ -1,8 +1,12 @@
 #pragma once
 
 #include "common/common.hpp"
+#include "script/heap.hpp"
 
-#include <variant>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <type_traits>
 
 namespace script {
 
@@ -16,14 +20,210 @@ enum ScriptObjectType : u8 {
     ClassInstance,
 };
 
-struct ScriptCallable;
-struct ScriptClass;
-struct ScriptClassInstance;
-
-struct ScriptObject {
+// Base of every value that lives on the heap. Objects are owned by the Heap, `size` is what the object counts towards
+// the collection threshold.
+struct ScriptHeapObject {
     u8 type;
+    bool marked;
+    bool remembered;
+    u32 size;
+
+    ScriptHeapObject(u8 type);
+    virtual ~ScriptHeapObject() = default;
+
+    // marks the objects this one references
+    virtual void trace(Heap& heap);
+
+    // Moves a young object into memory of its own when it gets promoted, only objects that are allocated in the
+    // nursery implement it.
+    virtual ScriptHeapObject* relocate();
+
+    // whether a young object has to be destroyed when it dies, because its destructor frees memory
+    virtual bool owns_memory() const;
+
+    virtual std::string to_string() = 0;
+};
+
+// Strings of identifiers and literals are interned in the StringTable, equal interned strings are the same object.
+// Strings built at runtime are not interned and compared by their characters.
+struct ScriptString : ScriptHeapObject {
+    // empty while the string is a rope that was not flattened yet, use str()
+    std::string value;
+    // only computed for interned strings
+    u32 hash;
+    bool interned;
+    bool flat;
+
+    ScriptString(std::string value);
+
+    const std::string& str() {
+        if (!flat)
+            flatten();
+        return value;
+    }
+
+    ScriptHeapObject* relocate() override;
+    bool owns_memory() const override;
+    std::string to_string() override;
+
+protected:
+    ScriptString();
 
-    std::variant<bool, f64, std::string, Arc<ScriptCallable>, Arc<ScriptClass>, Arc<ScriptClassInstance>> value;
+private:
+    void flatten();
 };
 
+// A NaN-boxed value. Numbers are stored as plain doubles, every other value is encoded in the payload of a quiet NaN:
+// nil and booleans as small tags and heap objects as a pointer with the sign bit set. Values are trivially copyable,
+// the heap finds out which objects are still referenced by tracing.
+class ScriptObject {
+public:
+    ScriptObject()
+        : _bits(nil_bits) {
+    }
+
+    explicit ScriptObject(bool value)
+        : _bits(value ? true_bits : false_bits) {
+    }
+
+    explicit ScriptObject(f64 value) {
+        std::memcpy(&_bits, &value, sizeof(f64));
+    }
+
+    explicit ScriptObject(ScriptHeapObject* object)
+        : _bits(sign_bit | qnan_bits | reinterpret_cast<u64>(object)) {
+    }
+
+    u8 type() const {
+        if (is_number())
+            return ScriptObjectType::Number;
+        if (is_object())
+            return as_object()->type;
+        return _bits == nil_bits ? ScriptObjectType::Nil : ScriptObjectType::Boolean;
+    }
+
+    bool is_nil() const {
+        return _bits == nil_bits;
+    }
+
+    bool is_boolean() const {
+        return (_bits | 1) == true_bits;
+    }
+
+    bool is_number() const {
+        return (_bits & qnan_bits) != qnan_bits;
+    }
+
+    bool is_object() const {
+        return (_bits & (sign_bit | qnan_bits)) == (sign_bit | qnan_bits);
+    }
+
+    bool is_object_type(ScriptObjectType type) const {
+        return is_object() && as_object()->type == type;
+    }
+
+    bool as_boolean() const {
+        return _bits == true_bits;
+    }
+
+    f64 as_number() const {
+        f64 value;
+        std::memcpy(&value, &_bits, sizeof(f64));
+        return value;
+    }
+
+    ScriptHeapObject* as_object() const {
+        return reinterpret_cast<ScriptHeapObject*>(_bits & ~(sign_bit | qnan_bits));
+    }
+
+    template<typename T>
+    T* as() const {
+        return static_cast<T*>(as_object());
+    }
+
+    const std::string& as_string() const {
+        return as<ScriptString>()->str();
+    }
+
+private:
+    static constexpr u64 sign_bit = 0x8000000000000000;
+    static constexpr u64 qnan_bits = 0x7ffc000000000000;
+
+    static constexpr u64 nil_bits = qnan_bits | 1;
+    static constexpr u64 false_bits = qnan_bits | 2;
+    static constexpr u64 true_bits = qnan_bits | 3;
+
+    u64 _bits;
+};
+
+static_assert(sizeof(ScriptObject) == 8);
+static_assert(std::is_trivially_copyable_v<ScriptObject>);
+
+// The result of a concatenation that was too long to copy right away. The parts are strings or numbers, the characters
+// are only put together once something needs them, so building a string piece by piece stays linear.
+struct ScriptRope : ScriptString {
+    // shorter results are concatenated right away
+    static constexpr usize min_length = 64;
+
+    ScriptObject left;
+    ScriptObject right;
+    usize length;
+
+    ScriptRope(const ScriptObject& left, const ScriptObject& right, usize length);
+
+    void trace(Heap& heap) override;
+    ScriptHeapObject* relocate() override;
+};
+
+inline bool Heap::is_young(const ScriptObject& value) const {
+    return value.is_object() && is_young(value.as_object());
+}
+
+inline void Heap::write_barrier(ScriptHeapObject* owner, const ScriptObject& value) {
+    if (!value.is_object())
+        return;
+
+    ScriptHeapObject* object = value.as_object();
+    if (is_young(object)) {
+        if (!owner->remembered && !is_young(owner)) {
+            owner->remembered = true;
+            _remembered.push_back(owner);
+        }
+    } else if (_phase == Phase::Marking && !object->marked) {
+        object->marked = true;
+        _gray.push_back(object);
+    }
+}
+
+// Every heap object has to be created through here (or Heap::track). The allocation may run a collection first, so
+// values the caller still needs have to be reachable from a root, and young objects move when they survive one.
+template<typename T, typename... TArgs>
+ScriptObject create_object(TArgs&&... args) {
+    Heap& heap = Heap::instance();
+
+    // strings are the only objects created here that tend to die young, everything else starts out old
+    T* object;
+    if constexpr (std::is_base_of_v<ScriptString, T>) {
+        object = new (heap.allocate_young(sizeof(T))) T(std::forward<TArgs>(args)...);
+    } else {
+        heap.prepare_allocation(sizeof(T));
+        object = new T(std::forward<TArgs>(args)...);
+    }
+
+    usize size = sizeof(T);
+    if constexpr (std::is_base_of_v<ScriptString, T>)
+        size += object->value.capacity();
+
+    return ScriptObject(heap.track(object, size));
+}
+
+bool is_true(const ScriptObject& object);
+bool is_equal(const ScriptObject& a, const ScriptObject& b);
+
+// `left + right` where at least one of them is a string and the other one a string or a number. Both have to be
+// reachable from a root, the result may be allocated before they are read.
+ScriptObject concatenate(ScriptObject& left, ScriptObject& right);
+
+std::ostream& operator<<(std::ostream& stream, const ScriptObject& object);
+
 } // namespace script
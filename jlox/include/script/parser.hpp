@@ -7,9 +7,9 @@ namespace script {
 
 class Parser {
 public:
-    Parser(const std::string& buffer);
+    Parser(Box<Source> source);
 
-    std::vector<Node::ptr>& parse();
+    Box<Program> parse();
     bool error() const;
 
 private:
@@ -18,7 +18,12 @@ private:
     Token _previous;
     bool _error;
     bool _allow_break_stmt;
-    std::vector<Node::ptr> _statements;
+    Box<Program> _program;
+
+    template<typename T, typename... TArgs>
+    std::unique_ptr<T, NodeDeleter> make_node(TArgs&&... args) {
+        return std::unique_ptr<T, NodeDeleter>(_program->arena.create<T>(std::forward<TArgs>(args)...));
+    }
 
     Token advance();
 
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common/common.hpp"
+
+namespace script {
+
+// Keeps freed blocks in per-size free lists instead of handing them back to the heap, so objects that are created and
+// destroyed over and over (upvalues of closures) reuse the same memory. Sizes are rounded up to size classes of
+// `granularity` bytes, requests bigger than `max_block_size` go straight to operator new.
+class Pool {
+public:
+    static constexpr usize granularity = 16;
+    static constexpr usize max_block_size = 512;
+
+    void* allocate(usize size);
+    void deallocate(void* block, usize size);
+
+    // The pool is never destroyed, values released during static destruction can still give their memory back.
+    static Pool& instance();
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* _free_lists[max_block_size / granularity] = {};
+};
+
+// Standard allocator over the shared pool, for containers and std::allocate_shared.
+template<typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) {
+    }
+
+    T* allocate(usize count) {
+        return static_cast<T*>(Pool::instance().allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* block, usize count) {
+        Pool::instance().deallocate(block, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const {
+        return true;
+    }
+};
+
+} // namespace script
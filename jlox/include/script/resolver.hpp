@@ -1,6 +1,8 @@
 #pragma once
 
-#include "interpreter.hpp"
+#include "ast.hpp"
+
+#include <unordered_map>
 
 namespace script {
 
@@ -15,13 +17,36 @@ enum class VariableState {
     Used,
 };
 
+struct ScopeVariable {
+    VariableState state;
+    u16 slot;
+    bool captured;
+};
+
+struct Scope {
+    std::unordered_map<std::string_view, ScopeVariable> variables;
+    u32 first_slot;
+};
+
+// Frame slots are handed out per function, the top level counts as a function without a declaration whose frame is
+// owned by the outermost block.
+struct FunctionScope {
+    FunctionStmt* function;
+    usize first_scope;
+    u32 frame_top;
+    u32 frame_size;
+};
+
 class Resolver : public Visitor {
 public:
-    Resolver(Interpreter* interpreter);
+    Resolver();
 
     bool error() const;
     void run(std::vector<Node::ptr>& statements);
 
+    // Without fusion the interpreter visits every node, for comparing against the fused sequences.
+    void set_fusion(bool enabled);
+
     void visit_print_stmt(PrintStmt* stmt) override;
     void visit_expr_stmt(ExprStmt* stmt) override;
     void visit_var_stmt(VarStmt* stmt) override;
@@ -47,8 +72,9 @@ public:
 
 private:
     bool _error;
-    Interpreter* _interpreter;
-    std::vector<std::unordered_map<std::string, VariableState>> _scopes;
+    bool _fusion;
+    std::vector<Scope> _scopes;
+    std::vector<FunctionScope> _functions;
     ScopeType _current_scope_type;
 
     void throw_error(Token& token, const std::string& error);
@@ -59,13 +85,19 @@ private:
     void resolve_function(FunctionStmt* stmt, ScopeType scope_type);
 
     void begin_scope();
-    void end_scope();
+    bool end_scope();
     void check_unused_variables();
 
-    void declare(Token& name);
+    VariableLocation declare(Token& name);
     void define(Token& name);
 
-    void resolve_local(Expr* expr, Token& name);
+    void resolve_local(VariableLocation& location, Token& name);
+    i32 find_local(usize function, std::string_view name);
+    i32 find_upvalue(usize function, std::string_view name);
+    i32 add_upvalue(usize function, u16 index, bool is_local);
+
+    // the fusion of a condition, only a fused binary expression is tested without visiting it
+    Fusion condition_fusion(Node* condition);
 };
 
 } // namespace script
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "script/string_table.hpp"
+
+namespace script {
+
+// Hidden class of a class instance: the names of its fields and the slot each one is stored in. Instances that got the
+// same fields in the same order share one shape, adding a field moves an instance along the transition to a child
+// shape. Shapes are never freed, their addresses identify a layout for the inline caches.
+class Shape {
+public:
+    // root of the transition tree, the shape of instances without fields
+    static Shape* empty();
+
+    Shape* add_field(ScriptString* name);
+    i32 find_field(ScriptString* name) const;
+
+    u32 field_count() const;
+
+private:
+    Shape() = default;
+
+    InternedMap<u32> _slots;
+    InternedMap<Box<Shape>> _transitions;
+};
+
+} // namespace script
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common/common.hpp"
+
+#include <string_view>
+
+namespace script {
+
+// The text of a script. Regular files are mapped read-only into memory, everything else (pipes, terminals, strings
+// built in memory) lives in an owned buffer. Tokens point into the source, so it must outlive the program parsed
+// from it.
+class Source {
+public:
+    explicit Source(std::string text);
+    ~Source();
+
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    // Returns nullptr if the file can't be opened or read.
+    static Box<Source> from_file(const char* path);
+
+    std::string_view text() const;
+    bool mapped() const;
+
+private:
+    Source() = default;
+
+    std::string _buffer;
+    void* _mapping = nullptr;
+    usize _mapping_size = 0;
+};
+
+} // namespace script
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "script/object.hpp"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace script {
+
+// Every identifier and string literal of a program is interned once, so equal names are the same ScriptString and can
+// be compared and hashed by pointer. Interned strings are never freed, like shapes they are shared by every program
+// and referenced from trees and chunks the collector does not trace.
+class StringTable {
+public:
+    static StringTable& instance();
+
+    ScriptString* intern(std::string_view value);
+
+    usize size() const;
+
+private:
+    static constexpr usize initial_capacity = 1024;
+
+    StringTable();
+
+    // open addressing with linear probing, the capacity is a power of two and at most half of it is used
+    std::vector<ScriptString*> _slots;
+    usize _size = 0;
+
+    void grow();
+};
+
+// Hashes interned strings by the hash they were created with.
+struct InternedHash {
+    usize operator()(const ScriptString* string) const {
+        return string->hash;
+    }
+};
+
+template<typename T>
+using InternedMap = std::unordered_map<ScriptString*, T, InternedHash>;
+
+} // namespace script
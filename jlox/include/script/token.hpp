@@ -3,9 +3,12 @@
 #include "../common/common.hpp"
 
 #include <string>
+#include <string_view>
 
 namespace script {
 
+struct ScriptString;
+
 enum TokenType : u32 {
     TT_INVALID,
     TT_EOF,
@@ -68,18 +71,14 @@ struct Token {
     explicit Token();
     explicit Token(TokenType type);
     explicit Token(TokenType type, u32 line);
-    explicit Token(TokenType type, u32 line, const std::string& value);
-
-    Token& operator=(const Token& rhs) {
-        type = rhs.type;
-        line = rhs.line;
-        value = rhs.value;
-        return *this;
-    }
+    explicit Token(TokenType type, u32 line, std::string_view value);
 
     u32 type;
     u32 line;
-    std::string value;
+    // Points into the source of the program the token was read from.
+    std::string_view value;
+    // The interned name of an identifier, set by the parser.
+    ScriptString* string;
 
     static const char* reserved_keywords[];
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "script/closure.hpp"
+#include "script/string_table.hpp"
+
+// Instructions are dispatched with computed goto where the compiler supports it, defining JLOX_SWITCH_DISPATCH falls
+// back to the portable switch.
+#if defined(__GNUC__) && !defined(JLOX_SWITCH_DISPATCH)
+#define JLOX_COMPUTED_GOTO
+#endif
+
+namespace script {
+
+struct CallFrame {
+    ScriptClosure* closure;
+    u8* ip;
+    ScriptObject* slots;
+};
+
+class VM : public RootSet {
+public:
+    // Calls nest at least as deep as the value stack of the interpreter has slots. A frame needs `frame_registers` free
+    // slots above its start for the call to succeed, beyond that the stack is shared by all frames.
+    static constexpr usize frames_max = 64 * 1024;
+    static constexpr usize stack_max = frames_max * 8;
+    static constexpr usize frame_registers = 256;
+
+    VM();
+    ~VM() override;
+
+    void interpret(Arc<FunctionProto> function);
+
+    // Globals are addressed by slot, the compiler asks the vm for the slot of a name once at compile time.
+    u16 global_slot(ScriptString* name);
+
+    // Functions compiled for this vm, their constants stay alive as long as the vm does.
+    void add_function(Arc<FunctionProto> function);
+
+    void mark_roots(Heap& heap) override;
+
+    // Adaptive instructions stay generic while quickening is off, sites that are already quickened stay quickened.
+    void set_quickening(bool enabled);
+    void print_quickening_stats();
+
+private:
+    std::unique_ptr<CallFrame[]> _frames;
+    usize _frame_count;
+    bool _quickening;
+
+    std::unique_ptr<ScriptObject[]> _stack;
+    ScriptObject* _stack_top;
+    ScriptObject* _stack_end;
+    OpenUpvalues _open_upvalues;
+
+    std::vector<ScriptObject> _globals;
+    std::vector<bool> _globals_defined;
+    std::vector<ScriptString*> _global_names;
+    InternedMap<u16> _global_slots;
+
+    std::vector<Arc<FunctionProto>> _functions;
+
+    void run();
+    void reset_stack();
+
+    void push(const ScriptObject& value);
+    ScriptObject pop();
+    ScriptObject& peek(usize distance);
+
+    void call_value(ScriptObject& callee, u8 arg_count);
+    void call(ScriptClosure* closure, u8 arg_count);
+
+    [[noreturn]] void runtime_error(const std::string& message);
+};
+
+} // namespace script
@@ -1,21 +1,57 @@
 #include "script/parser.hpp"
 #include "script/ast_dumper.hpp"
+#include "script/compiler.hpp"
 #include "script/interpreter.hpp"
 #include "script/resolver.hpp"
+#include "script/vm.hpp"
 
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 // TODO: chapter 11 challenge 4
 
 namespace script {
 
+enum class ExecutionMode {
+    Ast,
+    Vm,
+};
+
+ExecutionMode mode = ExecutionMode::Ast;
+bool disassemble = false;
+bool inline_cache_stats = false;
+bool quickening_stats = false;
+bool gc_stats = false;
+
 Interpreter interpreter;
+VM vm;
+
+// Functions keep pointing into the tree they were declared in, so every program stays alive until exit.
+std::vector<Box<Program>> programs;
 
-void process_buffer(const std::string& buffer) {
-    Parser parser(buffer);
+// Every statement is compiled right before it runs, a statement that fails to compile is skipped like one that fails
+// at runtime in the interpreter.
+void run_vm(std::vector<Node::ptr>& statements) {
+    for (auto& stmt : statements) {
+        Compiler compiler(&vm);
+        auto function = compiler.compile(stmt.get());
+
+        if (compiler.error())
+            continue;
 
-    std::vector<Node::ptr>& statements = parser.parse();
+        if (disassemble)
+            function->chunk.disassemble(function->name);
+
+        vm.interpret(function);
+    }
+}
+
+void process_source(Box<Source> source) {
+    Parser parser(std::move(source));
+
+    auto& program = programs.emplace_back(parser.parse());
+    auto& statements = program->statements;
 
     if (parser.error())
         return;
@@ -25,54 +61,78 @@ void process_buffer(const std::string& buffer) {
         json_dumper.dump(stmt.get());
     }
 
-    Resolver resolver(&interpreter);
+    Resolver resolver;
     resolver.run(statements);
 
     if (resolver.error())
         return;
 
+    if (mode == ExecutionMode::Vm) {
+        run_vm(statements);
+        return;
+    }
+
     for (auto& stmt : statements) {
         interpreter.interpret(stmt.get());
     }
 }
 
 void process_from_file(const char* path) {
-    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    auto source = Source::from_file(path);
 
-    if (!file.is_open()) {
+    if (!source) {
         std::cerr << "Failed to open script: " << path << "\n";
         return;
     }
 
-    usize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::string buffer;
-    if (size > 0) {
-        buffer.resize(size);
-        file.read(const_cast<char*>(buffer.data()), size);
-    }
-
-    file.close();
-
     std::cout << "Processing script: " << path << "\n";
-    process_buffer(buffer);
+    process_source(std::move(source));
 }
 
 } // namespace script
 
 int main(int argc, char** argv) {
-    if (argc > 2) {
-        std::cerr << "./lox [script]\n";
-        return 1;
+    const char* script = nullptr;
+
+    for (i32 i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--mode=ast") == 0) {
+            script::mode = script::ExecutionMode::Ast;
+        } else if (std::strcmp(argv[i], "--mode=vm") == 0) {
+            script::mode = script::ExecutionMode::Vm;
+        } else if (std::strcmp(argv[i], "--disassemble") == 0) {
+            script::disassemble = true;
+        } else if (std::strcmp(argv[i], "--ic-stats") == 0) {
+            script::inline_cache_stats = true;
+        } else if (std::strcmp(argv[i], "--quicken-stats") == 0) {
+            script::quickening_stats = true;
+        } else if (std::strcmp(argv[i], "--gc-stats") == 0) {
+            script::gc_stats = true;
+        } else if (std::strncmp(argv[i], "--gc-pause-target=", 18) == 0) {
+            script::interpreter.set_gc_pause_target(std::strtoull(argv[i] + 18, nullptr, 10));
+        } else if (!script && argv[i][0] != '-') {
+            script = argv[i];
+        } else {
+            std::cerr << "./lox [--mode=ast|vm] [--disassemble] [--ic-stats] [--quicken-stats] [--gc-stats] "
+                         "[--gc-pause-target=us] [script]\n";
+            return 1;
+        }
     }
 
-    if (argc == 1) {
+    if (!script) {
         std::string line;
         while (std::getline(std::cin, line)) {
-            script::process_buffer(line);
+            script::process_source(create_box<script::Source>(line));
         }
     } else {
-        script::process_from_file(argv[1]);
+        script::process_from_file(script);
     }
+
+    if (script::inline_cache_stats && script::mode == script::ExecutionMode::Ast)
+        script::interpreter.print_inline_cache_stats();
+
+    if (script::quickening_stats && script::mode == script::ExecutionMode::Vm)
+        script::vm.print_quickening_stats();
+
+    if (script::gc_stats)
+        script::Heap::instance().print_stats();
 }
@@ -0,0 +1,40 @@
+#include "script/arena.hpp"
+
+namespace script {
+
+void* Arena::allocate(usize size, usize alignment) {
+    _bytes_allocated += size;
+
+    auto address = reinterpret_cast<uintptr_t>(_cursor);
+    auto aligned = (address + alignment - 1) & ~(alignment - 1);
+
+    if (_cursor && aligned + size <= reinterpret_cast<uintptr_t>(_end)) {
+        _cursor = reinterpret_cast<u8*>(aligned + size);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Big allocations get a block of their own so the rest of the current block is not wasted.
+    if (size + alignment > block_size / 4) {
+        _blocks.push_back(Box<u8[]>(new u8[size + alignment]));
+        auto block = reinterpret_cast<uintptr_t>(_blocks.back().get());
+        return reinterpret_cast<void*>((block + alignment - 1) & ~(alignment - 1));
+    }
+
+    _blocks.push_back(Box<u8[]>(new u8[block_size]));
+    _cursor = _blocks.back().get();
+    _end = _cursor + block_size;
+
+    aligned = (reinterpret_cast<uintptr_t>(_cursor) + alignment - 1) & ~(alignment - 1);
+    _cursor = reinterpret_cast<u8*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
+
+usize Arena::bytes_allocated() const {
+    return _bytes_allocated;
+}
+
+usize Arena::block_count() const {
+    return _blocks.size();
+}
+
+} // namespace script
@@ -2,6 +2,10 @@
 
 namespace script {
 
+void NodeDeleter::operator()(Node* node) const {
+    node->~Node();
+}
+
 UnaryExpr::UnaryExpr(Token& op, Node::ptr expr)
     : op(op),
       expr(std::move(expr)) {
@@ -129,7 +133,10 @@ void VarStmt::accept(Visitor* visitor) {
 }
 
 BlockStmt::BlockStmt(std::vector<Node::ptr> statements)
-    : statements(std::move(statements)) {
+    : statements(std::move(statements)),
+      first_slot(0),
+      closes_upvalues(false),
+      frame_size(0) {
 }
 
 void BlockStmt::accept(Visitor* visitor) {
@@ -165,7 +172,8 @@ void BreakStmt::accept(Visitor* visitor) {
 FunctionStmt::FunctionStmt(Token& name, std::vector<Token> params, std::vector<Node::ptr> body)
     : name(name),
       params(params),
-      body(std::move(body)) {
+      body(std::move(body)),
+      frame_size(0) {
 }
 
 void FunctionStmt::accept(Visitor* visitor) {
@@ -1,4 +1,5 @@
 #include "script/ast_dumper.hpp"
+#include "script/object.hpp"
 
 // #include <format>
 #include <fmt/core.h>
@@ -195,7 +196,7 @@ void AstDumper::visit_literal_expr(LiteralExpr* node) {
         write_double_field("variable_value", std::get<f64>(node->value));
     } else if (node->literal_type == LiteralExpr::LiteralType::String) {
         write_str_field("variable_type", "string");
-        write_str_field("variable_value", std::get<std::string>(node->value));
+        write_str_field("variable_value", std::get<ScriptString*>(node->value)->value);
     }
 }
 
@@ -283,10 +284,10 @@ void AstDumper::write(const std::string& str, bool indentation, bool newline) {
         buffer += "\n";
 }
 
-void AstDumper::write_str_field(const std::string& field, const std::string& value) {
+void AstDumper::write_str_field(const std::string& field, std::string_view value) {
     write("\"" + field + "\"", true);
     write(": ");
-    write("\"" + value + "\"", false);
+    write("\"" + std::string(value) + "\"", false);
     write(",", false, true);
 }
 
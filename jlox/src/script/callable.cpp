@@ -2,14 +2,17 @@
 
 namespace script {
 
-ScriptCallable::ScriptCallable()
-    : type(ScriptCallableType::Invalid),
+ScriptCallable::ScriptCallable(u8 object_type)
+    : ScriptHeapObject(object_type),
+      callable_type(ScriptCallableType::Invalid),
       arity(0),
       function(0) {
 }
 
 ScriptCallable::ScriptCallable(u16 arity, function_type& function)
-    : arity(arity),
+    : ScriptHeapObject(ScriptObjectType::Callable),
+      callable_type(ScriptCallableType::Builtin),
+      arity(arity),
       function(function) {
 }
 
@@ -0,0 +1,232 @@
+#include "script/chunk.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <fmt/core.h>
+
+namespace script {
+
+static const char* opcode_names[] = {
+    "OP_CONSTANT",          "OP_NIL",               "OP_TRUE",              "OP_FALSE",
+    "OP_POP",               "OP_GET_LOCAL",         "OP_SET_LOCAL",         "OP_GET_GLOBAL",
+    "OP_DEFINE_GLOBAL",     "OP_SET_GLOBAL",        "OP_GET_UPVALUE",       "OP_SET_UPVALUE",
+    "OP_GET_PROPERTY",      "OP_SET_PROPERTY",      "OP_EQUAL",             "OP_NOT_EQUAL",
+    "OP_GREATER",           "OP_GREATER_EQUAL",     "OP_LESS",              "OP_LESS_EQUAL",
+    "OP_ADD",               "OP_SUBTRACT",          "OP_MULTIPLY",          "OP_DIVIDE",
+    "OP_NOT",               "OP_NEGATE",            "OP_PRINT",             "OP_JUMP",
+    "OP_JUMP_IF_FALSE",     "OP_JUMP_IF_TRUE",      "OP_LOOP",              "OP_CALL",
+    "OP_CLOSURE",           "OP_CLOSE_UPVALUE",     "OP_RETURN",            "OP_CLASS",
+    "OP_ADD_RK",            "OP_SUBTRACT_RK",       "OP_MULTIPLY_RK",       "OP_DIVIDE_RK",
+    "OP_EQUAL_RK",          "OP_NOT_EQUAL_RK",      "OP_GREATER_RK",        "OP_GREATER_EQUAL_RK",
+    "OP_LESS_RK",           "OP_LESS_EQUAL_RK",     "OP_ADD_RK_STORE",      "OP_SUBTRACT_RK_STORE",
+    "OP_MULTIPLY_RK_STORE", "OP_DIVIDE_RK_STORE",   "OP_ADD_NUM_RK",        "OP_EQUAL_NUM_RK",
+    "OP_NOT_EQUAL_NUM_RK",  "OP_ADD_NUM_RK_STORE",  "OP_TEST_GREATER",      "OP_TEST_GREATER_EQUAL",
+    "OP_TEST_LESS",         "OP_TEST_LESS_EQUAL",   "OP_GET_LOCAL_PROPERTY",
+};
+static_assert(std::size(opcode_names) == OP_COUNT, "every opcode needs a name");
+
+bool is_adaptive(u8 op) {
+    switch (op) {
+    case OP_ADD_RK:
+    case OP_EQUAL_RK:
+    case OP_NOT_EQUAL_RK:
+    case OP_ADD_RK_STORE:
+    case OP_ADD_NUM_RK:
+    case OP_EQUAL_NUM_RK:
+    case OP_NOT_EQUAL_NUM_RK:
+    case OP_ADD_NUM_RK_STORE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static std::string constant_to_string(const ScriptObject& constant) {
+    if (constant.is_object_type(ScriptObjectType::String))
+        return "\"" + constant.as_string() + "\"";
+
+    std::ostringstream stream;
+    stream << constant;
+    return stream.str();
+}
+
+FunctionProto::FunctionProto(const std::string& name)
+    : name(name),
+      arity(0),
+      upvalue_count(0) {
+}
+
+void FunctionProto::trace(Heap& heap) {
+    for (auto& constant : chunk.constants) {
+        heap.mark(constant);
+    }
+
+    for (auto& function : chunk.functions) {
+        function->trace(heap);
+    }
+}
+
+void Chunk::write(u8 byte, u32 line) {
+    code.push_back(byte);
+    lines.push_back(line);
+}
+
+usize Chunk::add_constant(const ScriptObject& value) {
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+usize Chunk::add_function(Arc<FunctionProto> function) {
+    functions.push_back(function);
+    return functions.size() - 1;
+}
+
+void Chunk::disassemble(const std::string& name) {
+    std::cout << "---- " << name << " ----\n";
+
+    for (usize offset = 0; offset < code.size();) {
+        offset = disassemble_instruction(offset);
+    }
+
+    std::cout << "----------------\n";
+
+    for (auto& function : functions) {
+        function->chunk.disassemble(function->name);
+    }
+}
+
+void Chunk::print_quickening_stats(const std::string& name) {
+    for (usize offset : adaptive_sites) {
+        u8 op = code[offset];
+        u8 deopts = code[offset + 4];
+
+        const char* state = "number fast path";
+        if (deopts == max_deopts)
+            state = "generic, gave up";
+        else if (op == OP_ADD_RK || op == OP_EQUAL_RK || op == OP_NOT_EQUAL_RK || op == OP_ADD_RK_STORE)
+            state = "generic";
+
+        std::cout << fmt::format("{:<12} line {:<5} {:<22} {}, {} deopts\n", name, lines[offset], opcode_names[op],
+                                 state, deopts);
+    }
+
+    for (auto& function : functions) {
+        function->chunk.print_quickening_stats(function->name);
+    }
+}
+
+usize Chunk::disassemble_instruction(usize offset) {
+    auto read_u16 = [&](usize at) {
+        return static_cast<u16>((code[at] << 8) | code[at + 1]);
+    };
+
+    std::cout << fmt::format("{:04} ", offset);
+    if (offset > 0 && lines[offset] == lines[offset - 1])
+        std::cout << "   | ";
+    else
+        std::cout << fmt::format("{:4} ", lines[offset]);
+
+    u8 op = code[offset];
+    if (op >= OP_COUNT) {
+        std::cout << "<unknown opcode " << static_cast<u32>(op) << ">\n";
+        return offset + 1;
+    }
+
+    std::cout << fmt::format("{:<22}", opcode_names[op]);
+
+    auto rk_to_string = [&](u8 operand) {
+        if (operand & rk_constant)
+            return fmt::format("k{} {}", operand & ~rk_constant, constant_to_string(constants[operand & ~rk_constant]));
+        return fmt::format("r{}", operand);
+    };
+
+    switch (op) {
+    case OP_CONSTANT:
+    case OP_GET_PROPERTY:
+    case OP_SET_PROPERTY:
+    case OP_CLASS: {
+        u16 index = read_u16(offset + 1);
+        std::cout << fmt::format("{:5} {}\n", index, constant_to_string(constants[index]));
+        return offset + 3;
+    }
+    case OP_GET_GLOBAL:
+    case OP_DEFINE_GLOBAL:
+    case OP_SET_GLOBAL:
+        std::cout << fmt::format("{:5}\n", read_u16(offset + 1));
+        return offset + 3;
+    case OP_GET_LOCAL:
+    case OP_SET_LOCAL:
+    case OP_GET_UPVALUE:
+    case OP_SET_UPVALUE:
+    case OP_CALL:
+        std::cout << fmt::format("{:5}\n", code[offset + 1]);
+        return offset + 2;
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_JUMP_IF_TRUE:
+        std::cout << fmt::format("{:5} -> {}\n", offset, offset + 3 + read_u16(offset + 1));
+        return offset + 3;
+    case OP_LOOP:
+        std::cout << fmt::format("{:5} -> {}\n", offset, offset + 3 - read_u16(offset + 1));
+        return offset + 3;
+    case OP_ADD_RK:
+    case OP_SUBTRACT_RK:
+    case OP_MULTIPLY_RK:
+    case OP_DIVIDE_RK:
+    case OP_EQUAL_RK:
+    case OP_NOT_EQUAL_RK:
+    case OP_GREATER_RK:
+    case OP_GREATER_EQUAL_RK:
+    case OP_LESS_RK:
+    case OP_LESS_EQUAL_RK:
+    case OP_ADD_RK_STORE:
+    case OP_SUBTRACT_RK_STORE:
+    case OP_MULTIPLY_RK_STORE:
+    case OP_DIVIDE_RK_STORE:
+    case OP_ADD_NUM_RK:
+    case OP_EQUAL_NUM_RK:
+    case OP_NOT_EQUAL_NUM_RK:
+    case OP_ADD_NUM_RK_STORE:
+        std::cout << fmt::format("r{} <- {}, {}", code[offset + 1], rk_to_string(code[offset + 2]),
+                                 rk_to_string(code[offset + 3]));
+        if (!is_adaptive(op)) {
+            std::cout << "\n";
+            return offset + 4;
+        }
+
+        std::cout << fmt::format(" ({} deopts)\n", code[offset + 4]);
+        return offset + 5;
+    case OP_TEST_GREATER:
+    case OP_TEST_GREATER_EQUAL:
+    case OP_TEST_LESS:
+    case OP_TEST_LESS_EQUAL:
+        std::cout << fmt::format("{}, {} {:5} -> {}\n", rk_to_string(code[offset + 1]), rk_to_string(code[offset + 2]),
+                                 offset, offset + 5 + read_u16(offset + 3));
+        return offset + 5;
+    case OP_GET_LOCAL_PROPERTY: {
+        u16 index = read_u16(offset + 2);
+        std::cout << fmt::format("{:5} {:5} {}\n", code[offset + 1], index, constant_to_string(constants[index]));
+        return offset + 4;
+    }
+    case OP_CLOSURE: {
+        u16 index = read_u16(offset + 1);
+        auto& function = functions[index];
+        std::cout << fmt::format("{:5} <fn {}>\n", index, function->name);
+
+        offset += 3;
+        for (u16 i = 0; i < function->upvalue_count; i++) {
+            bool is_local = code[offset];
+            u8 slot = code[offset + 1];
+            std::cout << fmt::format("{:04}    |   {} {}\n", offset, is_local ? "local" : "upvalue", slot);
+            offset += 2;
+        }
+        return offset;
+    }
+    default:
+        std::cout << "\n";
+        return offset + 1;
+    }
+}
+
+} // namespace script
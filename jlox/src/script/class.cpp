@@ -4,17 +4,13 @@
 namespace script {
 
 ScriptClass::ScriptClass(const std::string& name)
-    : name(name) {
+    : ScriptCallable(ScriptObjectType::Class),
+      name(name),
+      expected_fields(0) {
 }
 
 ScriptObject ScriptClass::call(Interpreter* interpreter, std::vector<ScriptObject>& arguments) {
-    ScriptObject obj;
-    obj.type = ScriptObjectType::ClassInstance;
-
-    auto arc_klass = this->shared_from_this();
-    obj.value = std::make_shared<ScriptClassInstance>(arc_klass);
-
-    return obj;
+    return ScriptClassInstance::create(this);
 }
 
 std::string ScriptClass::to_string() {
@@ -1,27 +1,110 @@
 #include "script/class_instance.hpp"
 #include "script/class.hpp"
 
-#include "common/exception.hpp"
+#include <algorithm>
+#include <memory>
+#include <new>
 
 namespace script {
 
-ScriptClassInstance::ScriptClassInstance(Arc<ScriptClass>& klass)
-    : klass(klass) {
+static_assert(sizeof(ScriptClassInstance) % alignof(ScriptObject) == 0);
+
+ScriptClassInstance::ScriptClassInstance(ScriptClass* klass, u32 inline_capacity)
+    : ScriptHeapObject(ScriptObjectType::ClassInstance),
+      klass(klass),
+      shape(Shape::empty()),
+      inline_capacity(inline_capacity) {
+    std::uninitialized_default_construct_n(inline_fields(), inline_capacity);
+}
+
+ScriptClassInstance::~ScriptClassInstance() {
+    std::destroy_n(inline_fields(), inline_capacity);
+}
+
+ScriptObject ScriptClassInstance::create(ScriptClass* klass) {
+    u32 capacity = std::min(klass->expected_fields, max_inline_capacity);
+    usize size = sizeof(ScriptClassInstance) + capacity * sizeof(ScriptObject);
+
+    Heap& heap = Heap::instance();
+    void* memory = heap.allocate_young(size);
+    return ScriptObject(heap.track(new (memory) ScriptClassInstance(klass, capacity), size));
+}
+
+void ScriptClassInstance::operator delete(void* memory) {
+    ::operator delete(memory);
+}
+
+ScriptObject* ScriptClassInstance::find_field(ScriptString* name) {
+    i32 slot = shape->find_field(name);
+    if (slot < 0)
+        return nullptr;
+
+    return &field(slot);
 }
 
-ScriptObject& ScriptClassInstance::get(Token& name) {
-    if (fields.contains(name.value)) {
-        return fields.at(name.value);
+u32 ScriptClassInstance::set(ScriptString* name, ScriptObject value) {
+    i32 slot = shape->find_field(name);
+    if (slot >= 0) {
+        field(slot) = std::move(value);
+        return static_cast<u32>(slot);
     }
 
-    throw RuntimeError(name, "Undefined property '" + name.value + "'");
+    add_field(shape->add_field(name), std::move(value));
+
+    return shape->field_count() - 1;
+}
+
+void ScriptClassInstance::add_field(Shape* next, ScriptObject value) {
+    u32 slot = shape->field_count();
+    shape = next;
+
+    if (slot < inline_capacity) {
+        inline_fields()[slot] = std::move(value);
+    } else {
+        // the overflow array is full whenever the new index is zero or a power of two
+        u32 index = slot - inline_capacity;
+        if ((index & (index - 1)) == 0) {
+            if (index == 0)
+                Heap::instance().add_finalizer(this);
+
+            auto grown = std::make_unique<ScriptObject[]>(index == 0 ? 1 : index * 2);
+            std::move(overflow.get(), overflow.get() + index, grown.get());
+            overflow = std::move(grown);
+        }
+
+        overflow[index] = std::move(value);
+    }
+
+    // later instances of the class get room for every field this one has
+    klass->expected_fields = std::max(klass->expected_fields, slot + 1);
+}
+
+void ScriptClassInstance::trace(Heap& heap) {
+    heap.mark(klass);
+
+    u32 count = shape->field_count();
+    for (u32 slot = 0; slot < count; slot++) {
+        heap.mark(field(slot));
+    }
+}
+
+ScriptHeapObject* ScriptClassInstance::relocate() {
+    void* memory = ::operator new(sizeof(ScriptClassInstance) + inline_capacity * sizeof(ScriptObject));
+    auto* instance = new (memory) ScriptClassInstance(klass, inline_capacity);
+
+    instance->shape = shape;
+    instance->overflow = std::move(overflow);
+    std::copy_n(inline_fields(), inline_capacity, instance->inline_fields());
+
+    return instance;
 }
 
-void ScriptClassInstance::set(Token& name, ScriptObject obj) {
-    fields[name.value] = obj;
+bool ScriptClassInstance::owns_memory() const {
+    // add_field() registers the instance once it allocates overflow fields
+    return false;
 }
 
-std::string ScriptClassInstance::to_string() const {
+std::string ScriptClassInstance::to_string() {
     return klass->name + " instance";
 }
 
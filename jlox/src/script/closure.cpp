@@ -0,0 +1,66 @@
+#include "script/closure.hpp"
+#include "script/pool.hpp"
+
+namespace script {
+
+ScriptUpvalue::ScriptUpvalue(ScriptObject* location)
+    : location(location),
+      remembered(false) {
+}
+
+Arc<ScriptUpvalue> OpenUpvalues::capture(ScriptObject* local) {
+    Arc<ScriptUpvalue> previous = nullptr;
+    Arc<ScriptUpvalue> upvalue = _head;
+
+    while (upvalue && upvalue->location > local) {
+        previous = upvalue;
+        upvalue = upvalue->next;
+    }
+
+    if (upvalue && upvalue->location == local)
+        return upvalue;
+
+    auto created = std::allocate_shared<ScriptUpvalue>(PoolAllocator<ScriptUpvalue>(), local);
+    created->next = upvalue;
+
+    if (previous)
+        previous->next = created;
+    else
+        _head = created;
+
+    return created;
+}
+
+void OpenUpvalues::close(ScriptObject* last) {
+    while (_head && _head->location >= last) {
+        Arc<ScriptUpvalue> upvalue = _head;
+        upvalue->closed = *upvalue->location;
+        upvalue->location = &upvalue->closed;
+        Heap::instance().write_barrier(upvalue);
+        _head = upvalue->next;
+        upvalue->next = nullptr;
+    }
+}
+
+ScriptClosure::ScriptClosure(Arc<FunctionProto> proto)
+    : proto(proto) {
+    callable_type = ScriptCallableType::Closure;
+    arity = proto->arity;
+    upvalues.resize(proto->upvalue_count);
+}
+
+void ScriptClosure::trace(Heap& heap) {
+    proto->trace(heap);
+
+    // upvalues are filled in right after the closure is created
+    for (auto& upvalue : upvalues) {
+        if (upvalue)
+            heap.mark(*upvalue->location);
+    }
+}
+
+std::string ScriptClosure::to_string() {
+    return "<fn>";
+}
+
+} // namespace script
@@ -0,0 +1,755 @@
+#include "script/compiler.hpp"
+#include "script/vm.hpp"
+
+#include "common/exception.hpp"
+
+#include <cassert>
+#include <iostream>
+
+namespace script {
+
+// register form of a binary operator, OP_COUNT if there is none
+static OpCode register_opcode(u32 op) {
+    switch (op) {
+    case TokenType::TT_PLUS:
+        return OP_ADD_RK;
+    case TokenType::TT_MINUS:
+        return OP_SUBTRACT_RK;
+    case TokenType::TT_STAR:
+        return OP_MULTIPLY_RK;
+    case TokenType::TT_SLASH:
+        return OP_DIVIDE_RK;
+    case TokenType::TT_GREATER:
+        return OP_GREATER_RK;
+    case TokenType::TT_GREATER_EQUAL:
+        return OP_GREATER_EQUAL_RK;
+    case TokenType::TT_LESS:
+        return OP_LESS_RK;
+    case TokenType::TT_LESS_EQUAL:
+        return OP_LESS_EQUAL_RK;
+    case TokenType::TT_BANG_EQUAL:
+        return OP_NOT_EQUAL_RK;
+    case TokenType::TT_EQUAL_EQUAL:
+        return OP_EQUAL_RK;
+    default:
+        return OP_COUNT;
+    }
+}
+
+// form of an arithmetic operator that assigns a local, OP_COUNT if there is none
+static OpCode store_opcode(u32 op) {
+    switch (op) {
+    case TokenType::TT_PLUS:
+        return OP_ADD_RK_STORE;
+    case TokenType::TT_MINUS:
+        return OP_SUBTRACT_RK_STORE;
+    case TokenType::TT_STAR:
+        return OP_MULTIPLY_RK_STORE;
+    case TokenType::TT_SLASH:
+        return OP_DIVIDE_RK_STORE;
+    default:
+        return OP_COUNT;
+    }
+}
+
+// slot of a local in the frame of the vm, slot 0 holds the called function
+static u8 frame_slot(const VariableLocation& location) {
+    return static_cast<u8>(location.slot + 1);
+}
+
+// test that jumps unless the comparison holds, OP_COUNT if the operator isn't a number comparison
+static OpCode test_opcode(u32 op) {
+    switch (op) {
+    case TokenType::TT_GREATER:
+        return OP_TEST_GREATER;
+    case TokenType::TT_GREATER_EQUAL:
+        return OP_TEST_GREATER_EQUAL;
+    case TokenType::TT_LESS:
+        return OP_TEST_LESS;
+    case TokenType::TT_LESS_EQUAL:
+        return OP_TEST_LESS_EQUAL;
+    default:
+        return OP_COUNT;
+    }
+}
+
+// Whether evaluating the expression can't assign a variable, e.g. through a call.
+static bool without_side_effects(Node* node) {
+    switch (node->type()) {
+    case Node::Type::LiteralExpr:
+    case Node::Type::VariableExpr:
+        return true;
+    case Node::Type::GroupingExpr:
+        return without_side_effects(static_cast<GroupingExpr*>(node)->expr.get());
+    case Node::Type::UnaryExpr:
+        return without_side_effects(static_cast<UnaryExpr*>(node)->expr.get());
+    case Node::Type::GetExpr:
+        return without_side_effects(static_cast<GetExpr*>(node)->object.get());
+    case Node::Type::BinaryExpr: {
+        auto* binary = static_cast<BinaryExpr*>(node);
+        return without_side_effects(binary->left.get()) && without_side_effects(binary->right.get());
+    }
+    default:
+        return false;
+    }
+}
+
+static ScriptObject literal_value(LiteralExpr* node) {
+    switch (node->literal_type) {
+    case LiteralExpr::LiteralType::Boolean:
+        return ScriptObject(std::get<bool>(node->value));
+    case LiteralExpr::LiteralType::Number:
+        return ScriptObject(std::get<f64>(node->value));
+    case LiteralExpr::LiteralType::String:
+        return ScriptObject(std::get<ScriptString*>(node->value));
+    default:
+        return ScriptObject();
+    }
+}
+
+Compiler::Compiler(VM* vm)
+    : _vm(vm),
+      _state(nullptr),
+      _error(false),
+      _registers(true),
+      _fusion(true),
+      _line(0) {
+}
+
+Arc<FunctionProto> Compiler::compile(Node* node) {
+    FunctionState state{ nullptr, std::make_shared<FunctionProto>("script"), {}, {}, 0, 0 };
+    state.locals.push_back({ 0, false });
+
+    _state = &state;
+
+    // constants are only reachable from the function once it is handed to the vm
+    Heap::NoCollection no_collection;
+
+    try {
+        compile_stmt(node);
+        emit_byte(OP_NIL);
+        emit_byte(OP_RETURN);
+    } catch (const CompileError& e) {
+        std::cerr << "[compiler error]: " << e.what() << "\n";
+        _state = nullptr;
+        return nullptr;
+    }
+
+    _state = nullptr;
+    _vm->add_function(state.function);
+    return state.function;
+}
+
+bool Compiler::error() const {
+    return _error;
+}
+
+void Compiler::set_registers(bool enabled) {
+    _registers = enabled;
+}
+
+void Compiler::set_fusion(bool enabled) {
+    _fusion = enabled;
+}
+
+void Compiler::visit_print_stmt(PrintStmt* stmt) {
+    compile_expr(stmt->expr.get());
+    emit_byte(OP_PRINT);
+}
+
+void Compiler::visit_expr_stmt(ExprStmt* stmt) {
+    compile_expr_stmt(stmt->expr.get());
+}
+
+void Compiler::visit_var_stmt(VarStmt* stmt) {
+    _line = stmt->name.line;
+
+    if (stmt->initializer)
+        compile_expr(stmt->initializer.get());
+    else
+        emit_byte(OP_NIL);
+
+    define_variable(stmt->name, stmt->location);
+}
+
+void Compiler::visit_block_stmt(BlockStmt* stmt) {
+    begin_scope();
+
+    for (auto& node : stmt->statements) {
+        compile_stmt(node.get());
+    }
+
+    end_scope();
+}
+
+void Compiler::visit_if_stmt(IfStmt* stmt) {
+    usize then_jump;
+    bool test = compile_test(stmt->condition.get(), then_jump);
+    if (!test) {
+        compile_expr(stmt->condition.get());
+        then_jump = emit_jump(OP_JUMP_IF_FALSE);
+        emit_byte(OP_POP);
+    }
+
+    compile_stmt(stmt->then_branch.get());
+
+    // a test leaves no condition behind that the else branch would have to pop
+    if (test && !stmt->else_branch) {
+        patch_jump(then_jump);
+        return;
+    }
+
+    usize else_jump = emit_jump(OP_JUMP);
+    patch_jump(then_jump);
+    if (!test)
+        emit_byte(OP_POP);
+
+    if (stmt->else_branch)
+        compile_stmt(stmt->else_branch.get());
+
+    patch_jump(else_jump);
+}
+
+void Compiler::visit_while_stmt(WhileStmt* stmt) {
+    usize loop_start = current_chunk().code.size();
+
+    usize exit_jump;
+    bool test = compile_test(stmt->condition.get(), exit_jump);
+    if (!test) {
+        compile_expr(stmt->condition.get());
+        exit_jump = emit_jump(OP_JUMP_IF_FALSE);
+        emit_byte(OP_POP);
+    }
+
+    _state->loops.push_back({ _state->scope_depth, {} });
+    compile_stmt(stmt->body.get());
+    emit_loop(loop_start);
+
+    patch_jump(exit_jump);
+    if (!test)
+        emit_byte(OP_POP);
+
+    // a break leaves the loop after the condition was already popped
+    for (usize break_jump : _state->loops.back().break_jumps) {
+        patch_jump(break_jump);
+    }
+
+    _state->loops.pop_back();
+}
+
+void Compiler::visit_break_stmt(BreakStmt* stmt) {
+    (void)stmt;
+
+    if (_state->loops.empty()) {
+        throw_error("a break statement may only be used within a loop");
+    }
+
+    Loop& loop = _state->loops.back();
+    discard_locals(loop.scope_depth);
+    loop.break_jumps.push_back(emit_jump(OP_JUMP));
+}
+
+void Compiler::visit_function_stmt(FunctionStmt* stmt) {
+    // anonymous functions are expressions, their closure is left on the stack
+    if (stmt->name.type == TokenType::TT_INVALID) {
+        compile_function(stmt);
+        return;
+    }
+
+    _line = stmt->name.line;
+
+    // a local function is defined before its body is compiled so that it can refer to itself
+    if (stmt->location.kind == VariableLocation::Local) {
+        add_local(stmt->location);
+        compile_function(stmt);
+        return;
+    }
+
+    compile_function(stmt);
+    define_variable(stmt->name, stmt->location);
+}
+
+void Compiler::visit_return_stmt(ReturnStmt* stmt) {
+    _line = stmt->keyword.line;
+
+    if (stmt->expr)
+        compile_expr(stmt->expr.get());
+    else
+        emit_byte(OP_NIL);
+
+    emit_byte(OP_RETURN);
+}
+
+void Compiler::visit_class_stmt(ClassStmt* stmt) {
+    _line = stmt->name.line;
+
+    emit_byte(OP_CLASS);
+    emit_u16(identifier_constant(stmt->name.string));
+    define_variable(stmt->name, stmt->location);
+}
+
+void Compiler::visit_unary_expr(UnaryExpr* node) {
+    compile_expr(node->expr.get());
+
+    _line = node->op.line;
+    if (node->op.type == TokenType::TT_MINUS)
+        emit_byte(OP_NEGATE);
+    else if (node->op.type == TokenType::TT_BANG)
+        emit_byte(OP_NOT);
+}
+
+void Compiler::visit_binary_expr(BinaryExpr* node) {
+    if (compile_register_binary(node))
+        return;
+
+    compile_expr(node->left.get());
+    compile_expr(node->right.get());
+
+    _line = node->op.line;
+
+    switch (node->op.type) {
+    case TokenType::TT_PLUS:
+        emit_byte(OP_ADD);
+        break;
+    case TokenType::TT_MINUS:
+        emit_byte(OP_SUBTRACT);
+        break;
+    case TokenType::TT_STAR:
+        emit_byte(OP_MULTIPLY);
+        break;
+    case TokenType::TT_SLASH:
+        emit_byte(OP_DIVIDE);
+        break;
+    case TokenType::TT_GREATER:
+        emit_byte(OP_GREATER);
+        break;
+    case TokenType::TT_GREATER_EQUAL:
+        emit_byte(OP_GREATER_EQUAL);
+        break;
+    case TokenType::TT_LESS:
+        emit_byte(OP_LESS);
+        break;
+    case TokenType::TT_LESS_EQUAL:
+        emit_byte(OP_LESS_EQUAL);
+        break;
+    case TokenType::TT_BANG_EQUAL:
+        emit_byte(OP_NOT_EQUAL);
+        break;
+    case TokenType::TT_EQUAL_EQUAL:
+        emit_byte(OP_EQUAL);
+        break;
+    default:
+        throw_error("unknown binary expression operator");
+        break;
+    }
+}
+
+void Compiler::visit_grouping_expr(GroupingExpr* node) {
+    compile_expr(node->expr.get());
+}
+
+void Compiler::visit_literal_expr(LiteralExpr* node) {
+    switch (node->literal_type) {
+    case LiteralExpr::LiteralType::Nil:
+        emit_byte(OP_NIL);
+        break;
+    case LiteralExpr::LiteralType::Boolean:
+        emit_byte(std::get<bool>(node->value) ? OP_TRUE : OP_FALSE);
+        break;
+    case LiteralExpr::LiteralType::Number:
+        emit_constant(ScriptObject(std::get<f64>(node->value)));
+        break;
+    case LiteralExpr::LiteralType::String:
+        emit_constant(ScriptObject(std::get<ScriptString*>(node->value)));
+        break;
+    }
+}
+
+void Compiler::visit_logical_expr(LogicalExpr* node) {
+    compile_expr(node->left.get());
+
+    _line = node->op.line;
+
+    // the left operand is the result if it short circuits, otherwise it is discarded
+    usize end_jump = emit_jump(node->op.type == TokenType::TT_OR ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE);
+    emit_byte(OP_POP);
+    _state->temporaries--;
+    compile_expr(node->right.get());
+    patch_jump(end_jump);
+}
+
+void Compiler::visit_conditional_expr(ConditionalExpr* node) {
+    compile_expr(node->expr.get());
+
+    usize else_jump = emit_jump(OP_JUMP_IF_FALSE);
+    emit_byte(OP_POP);
+    _state->temporaries--;
+    compile_expr(node->left.get());
+
+    // the other branch starts out with the condition on the stack as well
+    usize end_jump = emit_jump(OP_JUMP);
+    patch_jump(else_jump);
+    emit_byte(OP_POP);
+    _state->temporaries--;
+    compile_expr(node->right.get());
+    patch_jump(end_jump);
+}
+
+void Compiler::visit_variable_expr(VariableExpr* node) {
+    named_variable(node->name, node->location, false);
+}
+
+void Compiler::visit_assignment_expr(AssignmentExpr* node) {
+    compile_expr(node->value.get());
+    named_variable(node->name, node->location, true);
+}
+
+void Compiler::visit_call_expr(CallExpr* node) {
+    compile_expr(node->callee.get());
+
+    for (auto& arg : node->arguments) {
+        compile_expr(arg.get());
+    }
+
+    _line = node->paren.line;
+    emit_bytes(OP_CALL, static_cast<u8>(node->arguments.size()));
+}
+
+void Compiler::visit_get_expr(GetExpr* node) {
+    if (_fusion && node->object->type() == Node::Type::VariableExpr) {
+        auto& location = static_cast<VariableExpr*>(node->object.get())->location;
+        if (location.kind == VariableLocation::Local) {
+            _line = node->name.line;
+            emit_bytes(OP_GET_LOCAL_PROPERTY, frame_slot(location));
+            emit_u16(identifier_constant(node->name.string));
+            return;
+        }
+    }
+
+    compile_expr(node->object.get());
+
+    _line = node->name.line;
+    emit_byte(OP_GET_PROPERTY);
+    emit_u16(identifier_constant(node->name.string));
+}
+
+void Compiler::visit_set_expr(SetExpr* node) {
+    compile_expr(node->object.get());
+    compile_expr(node->value.get());
+
+    _line = node->name.line;
+    emit_byte(OP_SET_PROPERTY);
+    emit_u16(identifier_constant(node->name.string));
+}
+
+void Compiler::throw_error(const std::string& error) {
+    _error = true;
+    throw CompileError(error + " (line " + std::to_string(_line) + ")");
+}
+
+Chunk& Compiler::current_chunk() {
+    return _state->function->chunk;
+}
+
+void Compiler::compile_stmt(Node* node) {
+    // statements leave nothing but their locals on the stack
+    _state->temporaries = 0;
+
+    // the parser appends the increment of a 'for' loop as a bare expression to the loop body
+    if (node->type() <= Node::Type::SetExpr) {
+        compile_expr_stmt(node);
+        return;
+    }
+
+    node->accept(this);
+}
+
+void Compiler::compile_expr(Node* node) {
+    u32 temporaries = _state->temporaries;
+    node->accept(this);
+    _state->temporaries = temporaries + 1;
+}
+
+void Compiler::compile_expr_stmt(Node* expr) {
+    // the value of an assignment statement isn't needed, a local can be assigned without a temporary
+    if (expr->type() == Node::Type::AssignmentExpr && compile_register_store(static_cast<AssignmentExpr*>(expr)))
+        return;
+
+    compile_expr(expr);
+    emit_byte(OP_POP);
+}
+
+void Compiler::compile_function(FunctionStmt* stmt) {
+    FunctionState state{ _state, std::make_shared<FunctionProto>(std::string(stmt->name.value)), {}, {}, 0, 0 };
+    state.function->arity = static_cast<u16>(stmt->params.size());
+    state.locals.push_back({ 0, false });
+
+    _state = &state;
+
+    begin_scope();
+
+    // parameters take the first slots of the frame
+    for (usize i = 0; i < stmt->params.size(); i++) {
+        add_local({ VariableLocation::Local, static_cast<u16>(i) });
+    }
+
+    for (auto& node : stmt->body) {
+        compile_stmt(node.get());
+    }
+
+    emit_byte(OP_NIL);
+    emit_byte(OP_RETURN);
+
+    _state = state.enclosing;
+
+    auto& function = state.function;
+    function->upvalue_count = static_cast<u16>(stmt->upvalues.size());
+
+    usize index = current_chunk().add_function(function);
+    if (index > UINT16_MAX) {
+        throw_error("Too many functions in one chunk");
+    }
+
+    emit_byte(OP_CLOSURE);
+    emit_u16(static_cast<u16>(index));
+
+    for (auto& upvalue : stmt->upvalues) {
+        if (!upvalue.is_local) {
+            emit_bytes(0, static_cast<u8>(upvalue.index));
+            continue;
+        }
+
+        // a local that escapes into the closure is closed when its scope ends
+        u8 slot = frame_slot({ VariableLocation::Local, upvalue.index });
+        _state->locals[slot].captured = true;
+        emit_bytes(1, slot);
+    }
+}
+
+bool Compiler::compile_register_binary(BinaryExpr* node) {
+    OpCode op = register_opcode(node->op.type);
+    u32 result = next_register();
+    if (!_registers || op == OP_COUNT || result + 2 > rk_constant)
+        return false;
+
+    // the left operand is evaluated first, a local may only be read later if the right one can't change it
+    u8 left = rk_operand(node->left.get(), without_side_effects(node->right.get()));
+    u8 right = rk_operand(node->right.get(), true);
+
+    _line = node->op.line;
+    emit_register_instruction(op, static_cast<u8>(result), left, right);
+    return true;
+}
+
+bool Compiler::compile_register_store(AssignmentExpr* node) {
+    if (!_registers || node->value->type() != Node::Type::BinaryExpr)
+        return false;
+
+    auto* value = static_cast<BinaryExpr*>(node->value.get());
+    OpCode op = store_opcode(value->op.type);
+    if (op == OP_COUNT || node->location.kind != VariableLocation::Local || frame_slot(node->location) >= rk_constant)
+        return false;
+
+    // without temporaries there is nothing to pop afterwards
+    u8 left;
+    u8 right;
+    if (!rk_leaf(value->left.get(), true, left) || !rk_leaf(value->right.get(), true, right))
+        return false;
+
+    _line = value->op.line;
+    emit_register_instruction(op, frame_slot(node->location), left, right);
+    return true;
+}
+
+bool Compiler::compile_test(Node* condition, usize& jump) {
+    if (!_registers || !_fusion || condition->type() != Node::Type::BinaryExpr)
+        return false;
+
+    auto* binary = static_cast<BinaryExpr*>(condition);
+    OpCode op = test_opcode(binary->op.type);
+    if (op == OP_COUNT)
+        return false;
+
+    u8 left;
+    u8 right;
+    if (!rk_leaf(binary->left.get(), true, left) || !rk_leaf(binary->right.get(), true, right))
+        return false;
+
+    _line = binary->op.line;
+    emit_bytes(op, left);
+    emit_byte(right);
+    emit_u16(0xffff);
+    jump = current_chunk().code.size() - 2;
+    return true;
+}
+
+bool Compiler::rk_leaf(Node* node, bool read_locals, u8& operand) {
+    while (node->type() == Node::Type::GroupingExpr) {
+        node = static_cast<GroupingExpr*>(node)->expr.get();
+    }
+
+    if (node->type() == Node::Type::LiteralExpr) {
+        if (current_chunk().constants.size() >= rk_constant)
+            return false;
+
+        operand = static_cast<u8>(make_constant(literal_value(static_cast<LiteralExpr*>(node))) | rk_constant);
+        return true;
+    }
+
+    if (node->type() == Node::Type::VariableExpr && read_locals) {
+        auto& location = static_cast<VariableExpr*>(node)->location;
+        if (location.kind != VariableLocation::Local || frame_slot(location) >= rk_constant)
+            return false;
+
+        operand = frame_slot(location);
+        return true;
+    }
+
+    return false;
+}
+
+u8 Compiler::rk_operand(Node* node, bool read_locals) {
+    u8 operand;
+    if (rk_leaf(node, read_locals, operand))
+        return operand;
+
+    operand = static_cast<u8>(next_register());
+    compile_expr(node);
+    return operand;
+}
+
+u32 Compiler::next_register() {
+    return static_cast<u32>(_state->locals.size()) + _state->temporaries;
+}
+
+void Compiler::emit_byte(u8 byte) {
+    current_chunk().write(byte, _line);
+}
+
+void Compiler::emit_bytes(u8 a, u8 b) {
+    emit_byte(a);
+    emit_byte(b);
+}
+
+void Compiler::emit_u16(u16 value) {
+    emit_byte((value >> 8) & 0xff);
+    emit_byte(value & 0xff);
+}
+
+void Compiler::emit_register_instruction(OpCode op, u8 a, u8 b, u8 c) {
+    auto& chunk = current_chunk();
+    if (is_adaptive(op))
+        chunk.adaptive_sites.push_back(chunk.code.size());
+
+    emit_bytes(op, a);
+    emit_bytes(b, c);
+
+    // adaptive instructions start out generic without deopts
+    if (is_adaptive(op))
+        emit_byte(0);
+}
+
+void Compiler::emit_constant(const ScriptObject& value) {
+    emit_byte(OP_CONSTANT);
+    emit_u16(make_constant(value));
+}
+
+usize Compiler::emit_jump(OpCode op) {
+    emit_byte(op);
+    emit_u16(0xffff);
+    return current_chunk().code.size() - 2;
+}
+
+void Compiler::emit_loop(usize loop_start) {
+    emit_byte(OP_LOOP);
+
+    usize offset = current_chunk().code.size() - loop_start + 2;
+    if (offset > UINT16_MAX) {
+        throw_error("Loop body too large");
+    }
+
+    emit_u16(static_cast<u16>(offset));
+}
+
+void Compiler::patch_jump(usize offset) {
+    auto& code = current_chunk().code;
+
+    usize jump = code.size() - offset - 2;
+    if (jump > UINT16_MAX) {
+        throw_error("Too much code to jump over");
+    }
+
+    code[offset] = (jump >> 8) & 0xff;
+    code[offset + 1] = jump & 0xff;
+}
+
+u16 Compiler::make_constant(const ScriptObject& value) {
+    usize index = current_chunk().add_constant(value);
+    if (index > UINT16_MAX) {
+        throw_error("Too many constants in one chunk");
+    }
+
+    return static_cast<u16>(index);
+}
+
+u16 Compiler::identifier_constant(ScriptString* name) {
+    return make_constant(ScriptObject(name));
+}
+
+void Compiler::begin_scope() {
+    _state->scope_depth++;
+}
+
+void Compiler::end_scope() {
+    _state->scope_depth--;
+
+    auto& locals = _state->locals;
+    while (!locals.empty() && locals.back().depth > _state->scope_depth) {
+        emit_byte(locals.back().captured ? OP_CLOSE_UPVALUE : OP_POP);
+        locals.pop_back();
+    }
+}
+
+void Compiler::discard_locals(i32 depth) {
+    auto& locals = _state->locals;
+    for (auto local = locals.rbegin(); local != locals.rend() && local->depth > depth; local++) {
+        emit_byte(local->captured ? OP_CLOSE_UPVALUE : OP_POP);
+    }
+}
+
+void Compiler::add_local(const VariableLocation& location) {
+    // the value on top of the stack becomes the local, which is where the resolver expects it
+    assert(frame_slot(location) == _state->locals.size());
+    (void)location;
+
+    _state->locals.push_back({ _state->scope_depth, false });
+}
+
+void Compiler::define_variable(const Token& name, const VariableLocation& location) {
+    if (location.kind == VariableLocation::Local) {
+        add_local(location);
+        return;
+    }
+
+    emit_byte(OP_DEFINE_GLOBAL);
+    emit_u16(_vm->global_slot(name.string));
+}
+
+void Compiler::named_variable(Token& name, const VariableLocation& location, bool assign) {
+    _line = name.line;
+
+    switch (location.kind) {
+    case VariableLocation::Local:
+        emit_bytes(assign ? OP_SET_LOCAL : OP_GET_LOCAL, frame_slot(location));
+        break;
+    case VariableLocation::Upvalue:
+        emit_bytes(assign ? OP_SET_UPVALUE : OP_GET_UPVALUE, static_cast<u8>(location.slot));
+        break;
+    default:
+        emit_byte(assign ? OP_SET_GLOBAL : OP_GET_GLOBAL);
+        emit_u16(_vm->global_slot(name.string));
+        break;
+    }
+}
+
+} // namespace script
@@ -5,66 +5,65 @@
 
 namespace script {
 
-ScriptEnvironment::ScriptEnvironment()
-    : _enclosing(0) {
-}
-
-ScriptEnvironment::ScriptEnvironment(ScriptEnvironment* enclosing)
-    : _enclosing(enclosing) {
-}
-
-void ScriptEnvironment::set_name(const std::string& name) {
-    _name = name;
+ScriptEnvironment::ScriptEnvironment() {
 }
 
 void ScriptEnvironment::assign_variable(const Token& name, ScriptObject& value) {
-    auto itr = _variables.find(name.value);
+    auto itr = _variables.find(name.string);
     if (itr != _variables.end()) {
-        itr->second.value = value.value;
-        return;
-    }
-
-    if (_enclosing) {
-        _enclosing->assign_variable(name, value);
+        itr->second = value;
+        write_barrier(itr->second);
         return;
     }
 
-    throw RuntimeError(name, "Undefined variable '" + name.value + "'.");
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.value) + "'.");
 }
 
-void ScriptEnvironment::assign_variable_at(usize distance, const Token& name, ScriptObject& value) {
-    ScriptEnvironment* ancestor = get_ancestor(distance);
-
-    // TODO: ensure that we can do obj == obj
-    ancestor->_variables[name.value] = value;
-}
+void ScriptEnvironment::define_variable(ScriptString* name, ScriptObject& value) {
+    auto itr = _variables.find(name);
+    if (itr != _variables.end()) {
+        itr->second = value;
+        write_barrier(itr->second);
+        return;
+    }
 
-void ScriptEnvironment::define_variable(const std::string& name, ScriptObject& value) {
-    _variables[name] = value;
+    write_barrier(_variables.emplace(name, value).first->second);
 }
 
 void ScriptEnvironment::define_function(const std::string& name, u16 arity, ScriptCallable::function_type& function) {
-    ScriptObject variable;
-    variable.type = ScriptObjectType::Callable;
-    variable.value = std::make_shared<ScriptCallable>(arity, function); // TODO: Arc::make<ScriptCallable>()
-
-    _variables.insert({ name, variable });
+    _variables.insert({ StringTable::instance().intern(name), create_object<ScriptCallable>(arity, function) });
 }
 
 ScriptObject& ScriptEnvironment::find_variable(const Token& name) {
-    auto itr = _variables.find(name.value);
+    auto itr = _variables.find(name.string);
     if (itr != _variables.end())
         return itr->second;
 
-    if (_enclosing)
-        return _enclosing->find_variable(name);
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.value) + "'.");
+}
+
+void ScriptEnvironment::mark(Heap& heap) {
+    if (heap.collecting_young()) {
+        for (auto* variable : _young_variables) {
+            heap.mark(*variable);
+        }
+
+        _young_variables.clear();
+        return;
+    }
 
-    throw RuntimeError(name, "Undefined variable '" + name.value + "'.");
+    for (auto& variable : _variables) {
+        heap.mark(variable.second);
+    }
 }
 
-ScriptObject& ScriptEnvironment::find_variable_at(usize distance, const Token& name) {
-    ScriptEnvironment* ancestor = get_ancestor(distance);
-    return ancestor->_variables[name.value];
+void ScriptEnvironment::write_barrier(ScriptObject& variable) {
+    if (!Heap::instance().is_young(variable))
+        return;
+
+    // a loop assigning to the same global over and over only needs one entry
+    if (_young_variables.empty() || _young_variables.back() != &variable)
+        _young_variables.push_back(&variable);
 }
 
 void ScriptEnvironment::print(u32 indent) {
@@ -72,24 +71,10 @@ void ScriptEnvironment::print(u32 indent) {
     for (auto& var : _variables) {
         for (u32 i = 0; i < indent; i++)
             std::cout << " ";
-        std::cout << var.first << ": type = " << (u32)var.second.type << "\n";
-    }
-
-    if (_enclosing) {
-        _enclosing->print(indent + 1);
+        std::cout << var.first->value << ": type = " << (u32)var.second.type() << "\n";
     }
 
     std::cout << "----------------------------------\n";
 }
 
-ScriptEnvironment* ScriptEnvironment::get_ancestor(usize distance) {
-    ScriptEnvironment* ancestor = this;
-
-    for (usize i = 0; i < distance; i++) {
-        ancestor = ancestor->_enclosing;
-    }
-
-    return ancestor;
-}
-
 } // namespace script
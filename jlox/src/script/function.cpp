@@ -3,45 +3,28 @@
 
 namespace script {
 
-ScriptFunction::ScriptFunction(FunctionStmt* decl, Arc<ScriptEnvironment> closure, bool anonymous)
+ScriptFunction::ScriptFunction(FunctionStmt* decl, bool anonymous)
     : decl(decl),
-      closure(closure),
       anonymous(anonymous) {
-    type = ScriptCallableType::Function;
+    callable_type = ScriptCallableType::Function;
     arity = decl->params.size();
+    upvalues.resize(decl->upvalues.size());
 }
 
 ScriptObject ScriptFunction::call(Interpreter* interpreter, std::vector<ScriptObject>& arguments) {
-    Arc<ScriptEnvironment> environment = closure;
-
-    for (i32 i = 0; i < decl->params.size(); i++) {
-        auto& arg = arguments.at(i);
-        auto& param = decl->params.at(i);
-
-        // rename anonymous function to param name if possible
-        if (arg.type == ScriptObjectType::Callable) {
-            auto callable = std::get<Arc<ScriptCallable>>(arg.value);
-            if (callable->type == ScriptCallableType::Function) {
-                auto* func = reinterpret_cast<ScriptFunction*>(callable.get());
-                if (func->anonymous) {
-                    func->decl->name.value = param.value;
-                }
-            }
-        }
-
-        environment->define_variable(param.value, arg);
+    // the interpreter expects the callee and the arguments on its value stack, they become the frame of the call
+    interpreter->push(ScriptObject(this));
+    for (auto& arg : arguments) {
+        interpreter->push(arg);
     }
 
-    interpreter->execute_block(decl->body, environment);
+    return interpreter->call_function(this, static_cast<u8>(arguments.size()));
+}
 
-    if (interpreter->control_flow_state() == ControlFlowState::Return) {
-        interpreter->set_control_flow_state(ControlFlowState::None);
-        return interpreter->expr_result();
+void ScriptFunction::trace(Heap& heap) {
+    for (auto& upvalue : upvalues) {
+        heap.mark(*upvalue->location);
     }
-
-    ScriptObject result;
-    result.type = ScriptObjectType::Nil;
-    return result;
 }
 
 std::string ScriptFunction::to_string() {
@@ -0,0 +1,480 @@
+#include "script/heap.hpp"
+#include "script/class_instance.hpp"
+#include "script/closure.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <fmt/core.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#else
+#define ASAN_POISON_MEMORY_REGION(address, size) ((void)(address), (void)(size))
+#define ASAN_UNPOISON_MEMORY_REGION(address, size) ((void)(address), (void)(size))
+#endif
+
+namespace script {
+
+// What is left in the nursery of an object that was promoted. Young objects are never marked otherwise, the mark tells
+// a minor collection that the object already moved.
+struct Forwarded : ScriptHeapObject {
+    ScriptHeapObject* to;
+
+    Forwarded(ScriptHeapObject* to)
+        : ScriptHeapObject(ScriptObjectType::Nil),
+          to(to) {
+        marked = true;
+    }
+
+    std::string to_string() override {
+        return "<forwarded>";
+    }
+};
+
+static_assert(sizeof(Forwarded) <= sizeof(ScriptString));
+static_assert(sizeof(Forwarded) <= sizeof(ScriptClassInstance));
+
+static constexpr usize nursery_alignment = 16;
+
+// gray objects traced or objects swept between two looks at the clock
+#ifdef JLOX_STRESS_GC
+static constexpr usize slice_chunk = 1;
+#else
+static constexpr usize slice_chunk = 64;
+#endif
+
+static u64 now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void PauseHistogram::record(u64 pause_ns) {
+    u64 pause_us = pause_ns / 1000;
+
+    usize bucket = 0;
+    while (pause_us > 0 && bucket < bucket_count - 1) {
+        pause_us >>= 1;
+        bucket++;
+    }
+
+    buckets[bucket]++;
+}
+
+u64 PauseHistogram::bucket_limit_us(usize bucket) {
+    return u64(1) << bucket;
+}
+
+Heap& Heap::instance() {
+    static Heap* heap = new Heap();
+    return *heap;
+}
+
+Heap::Heap() {
+    _nursery = static_cast<u8*>(::operator new(nursery_size, std::align_val_t(nursery_alignment)));
+    _nursery_top = _nursery;
+    ASAN_POISON_MEMORY_REGION(_nursery, nursery_size);
+}
+
+void Heap::prepare_allocation(usize size) {
+    _allocated_since_slice += size;
+
+#ifdef JLOX_STRESS_GC
+    bool due = true;
+#else
+    bool due = slice_due();
+#endif
+
+    if (!due || _no_collection > 0)
+        return;
+
+    u64 start = now_ns();
+    step();
+    record_pause(start);
+}
+
+void* Heap::allocate_young(usize size) {
+    assert(size <= nursery_size);
+
+    if (_no_collection > 0)
+        return ::operator new(size);
+
+    usize aligned = (size + nursery_alignment - 1) & ~(nursery_alignment - 1);
+    _allocated_since_slice += aligned;
+
+#ifdef JLOX_STRESS_GC
+    bool full = true;
+    bool due = true;
+#else
+    bool full = _nursery_top + aligned > _nursery + nursery_size;
+    bool due = slice_due();
+#endif
+
+    if (full || due) {
+        u64 start = now_ns();
+        if (full)
+            collect_young();
+        if (due || slice_due())
+            step();
+        record_pause(start);
+    }
+
+    void* memory = _nursery_top;
+    _nursery_top += aligned;
+    ASAN_UNPOISON_MEMORY_REGION(memory, size);
+
+    return memory;
+}
+
+ScriptHeapObject* Heap::track(ScriptHeapObject* object, usize size) {
+    object->size = static_cast<u32>(size);
+
+    if (is_young(object)) {
+        if (object->owns_memory())
+            _finalizers.push_back(object);
+        return object;
+    }
+
+    _bytes_allocated += size;
+    _objects.push_back(object);
+    allocated_old(object);
+    return object;
+}
+
+void Heap::mark(ScriptObject& value) {
+    if (!value.is_object())
+        return;
+
+    ScriptHeapObject* object = value.as_object();
+    if (!is_young(object)) {
+        mark(object);
+        return;
+    }
+
+    // young objects are only ever looked at by minor collections, the ones a marked object references are promoted
+    // and marked at the latest when marking finishes
+    if (!_collecting_young)
+        return;
+
+    if (!object->marked)
+        promote(object);
+
+    value = ScriptObject(static_cast<Forwarded*>(object)->to);
+}
+
+void Heap::mark(ScriptHeapObject* object) {
+    // plain pointers only ever point to old objects, a minor collection has nothing to do for them
+    if (_collecting_young || object->marked)
+        return;
+
+    object->marked = true;
+    _gray.push_back(object);
+}
+
+void Heap::write_barrier(const Arc<ScriptUpvalue>& upvalue) {
+    if (upvalue->location != &upvalue->closed)
+        return;
+
+    ScriptObject& value = upvalue->closed;
+    if (!value.is_object())
+        return;
+
+    ScriptHeapObject* object = value.as_object();
+    if (is_young(object)) {
+        if (!upvalue->remembered) {
+            upvalue->remembered = true;
+            _remembered_upvalues.push_back(upvalue);
+        }
+    } else if (_phase == Phase::Marking && !object->marked) {
+        object->marked = true;
+        _gray.push_back(object);
+    }
+}
+
+void Heap::add_finalizer(ScriptHeapObject* object) {
+    if (is_young(object))
+        _finalizers.push_back(object);
+}
+
+void Heap::collect() {
+    if (_no_collection > 0)
+        return;
+
+    u64 start = now_ns();
+    u64 pause_target = _pause_target_ns;
+    _pause_target_ns = 0;
+
+    if (_phase != Phase::Idle)
+        step();
+    step();
+
+    _pause_target_ns = pause_target;
+    record_pause(start);
+}
+
+void Heap::collect_young() {
+    if (_no_collection > 0)
+        return;
+
+    u64 start = now_ns();
+    _collecting_young = true;
+
+    for (auto* roots : _roots) {
+        roots->mark_roots(*this);
+    }
+
+    for (auto* object : _remembered) {
+        object->remembered = false;
+        object->trace(*this);
+    }
+
+    for (auto& upvalue : _remembered_upvalues) {
+        upvalue->remembered = false;
+        mark(upvalue->closed);
+    }
+
+    // promoted objects may still reference young ones
+    while (!_promoted.empty()) {
+        ScriptHeapObject* object = _promoted.back();
+        _promoted.pop_back();
+        object->trace(*this);
+    }
+
+    for (auto* object : _finalizers) {
+        if (!object->marked)
+            object->~ScriptHeapObject();
+    }
+
+    _finalizers.clear();
+    _remembered.clear();
+    _remembered_upvalues.clear();
+    reset_nursery();
+
+    _collecting_young = false;
+
+    u64 pause = now_ns() - start;
+    _stats.minor_collections++;
+    _stats.minor_total_pause_ns += pause;
+    _stats.minor_max_pause_ns = std::max(_stats.minor_max_pause_ns, pause);
+}
+
+void Heap::set_pause_target(u64 pause_ns) {
+    _pause_target_ns = pause_ns;
+}
+
+u64 Heap::pause_target() const {
+    return _pause_target_ns;
+}
+
+bool Heap::slice_due() const {
+    if (_phase == Phase::Idle)
+        return _bytes_allocated > _next_collection;
+    return _allocated_since_slice >= slice_interval;
+}
+
+void Heap::step() {
+    u64 start = now_ns();
+    _allocated_since_slice = 0;
+
+    if (_phase == Phase::Idle) {
+        _phase = Phase::Marking;
+        mark_roots();
+    }
+
+    if (_phase == Phase::Marking && mark_slice(start))
+        finish_marking();
+
+    if (_phase == Phase::Sweeping && sweep_slice(start))
+        finish_cycle();
+
+    u64 pause = now_ns() - start;
+    _stats.slices++;
+    _stats.total_pause_ns += pause;
+    _stats.max_pause_ns = std::max(_stats.max_pause_ns, pause);
+}
+
+void Heap::mark_roots() {
+    for (auto* roots : _roots) {
+        roots->mark_roots(*this);
+    }
+}
+
+bool Heap::mark_slice(u64 start_ns) {
+    while (!_gray.empty()) {
+        for (usize i = 0; i < slice_chunk && !_gray.empty(); i++) {
+            ScriptHeapObject* object = _gray.back();
+            _gray.pop_back();
+            object->trace(*this);
+        }
+
+        if (out_of_time(start_ns))
+            return _gray.empty();
+    }
+
+    return true;
+}
+
+void Heap::finish_marking() {
+    // roots have no write barrier, they are marked once more while nothing runs. Emptying the nursery first promotes
+    // and marks the young objects marked objects reference.
+    collect_young();
+    mark_roots();
+
+    while (!_gray.empty()) {
+        ScriptHeapObject* object = _gray.back();
+        _gray.pop_back();
+        object->trace(*this);
+    }
+
+    _phase = Phase::Sweeping;
+    _sweep_cursor = 0;
+    _sweep_live = 0;
+}
+
+bool Heap::sweep_slice(u64 start_ns) {
+    // objects allocated while sweeping are appended marked, the sweep reaches them and keeps them
+    while (_sweep_cursor < _objects.size()) {
+        for (usize i = 0; i < slice_chunk && _sweep_cursor < _objects.size(); i++) {
+            ScriptHeapObject* object = _objects[_sweep_cursor++];
+            if (object->marked) {
+                object->marked = false;
+                _objects[_sweep_live++] = object;
+                continue;
+            }
+
+            _bytes_allocated -= object->size;
+            _stats.bytes_freed += object->size;
+            _stats.objects_freed++;
+            delete object;
+        }
+
+        if (out_of_time(start_ns))
+            return _sweep_cursor == _objects.size();
+    }
+
+    return true;
+}
+
+void Heap::finish_cycle() {
+    _objects.resize(_sweep_live);
+    _next_collection = std::max(_bytes_allocated * growth_factor, initial_threshold);
+    _phase = Phase::Idle;
+    _stats.collections++;
+}
+
+bool Heap::out_of_time(u64 start_ns) const {
+    if (_pause_target_ns == 0)
+        return false;
+
+    // a script that allocates faster than the slices keep up with gets the rest of the cycle in one go
+    if (_bytes_allocated > _next_collection * growth_factor)
+        return false;
+
+#ifdef JLOX_STRESS_GC
+    return true;
+#else
+    return now_ns() - start_ns >= _pause_target_ns;
+#endif
+}
+
+void Heap::allocated_old(ScriptHeapObject* object) {
+    if (_phase == Phase::Marking) {
+        object->marked = true;
+        _gray.push_back(object);
+    } else if (_phase == Phase::Sweeping) {
+        object->marked = true;
+    }
+}
+
+ScriptHeapObject* Heap::promote(ScriptHeapObject* object) {
+    ScriptHeapObject* promoted = object->relocate();
+    assert(promoted);
+
+    promoted->size = object->size;
+    _bytes_allocated += promoted->size;
+    _objects.push_back(promoted);
+    _promoted.push_back(promoted);
+    allocated_old(promoted);
+
+    _stats.objects_promoted++;
+    _stats.bytes_promoted += promoted->size;
+
+    object->~ScriptHeapObject();
+    new (object) Forwarded(promoted);
+
+    return promoted;
+}
+
+void Heap::reset_nursery() {
+#ifdef JLOX_STRESS_GC
+    // keep handing out fresh memory for as long as possible, a stale reference into the nursery then hits poisoned
+    // memory instead of a new object
+    if (_nursery_top < _nursery + nursery_size / 2) {
+        ASAN_POISON_MEMORY_REGION(_nursery, _nursery_top - _nursery);
+        return;
+    }
+#endif
+
+    ASAN_POISON_MEMORY_REGION(_nursery, nursery_size);
+    _nursery_top = _nursery;
+}
+
+void Heap::record_pause(u64 start_ns) {
+    _stats.pauses.record(now_ns() - start_ns);
+}
+
+void Heap::add_roots(RootSet* roots) {
+    _roots.push_back(roots);
+}
+
+void Heap::remove_roots(RootSet* roots) {
+    _roots.erase(std::remove(_roots.begin(), _roots.end(), roots), _roots.end());
+}
+
+const GcStats& Heap::stats() const {
+    return _stats;
+}
+
+usize Heap::bytes_allocated() const {
+    return _bytes_allocated;
+}
+
+void Heap::print_stats() {
+    std::cout << "-------- GC STATS --------\n";
+    std::cout << fmt::format("minor collections: {}\n", _stats.minor_collections);
+    std::cout << fmt::format("objects promoted:  {} ({} bytes)\n", _stats.objects_promoted, _stats.bytes_promoted);
+    std::cout << fmt::format("minor pause:       {:.3f} ms total, {:.3f} ms max\n", _stats.minor_total_pause_ns / 1e6,
+                             _stats.minor_max_pause_ns / 1e6);
+    std::cout << fmt::format("major collections: {} in {} slices\n", _stats.collections, _stats.slices);
+    std::cout << fmt::format("objects freed:     {} ({} bytes)\n", _stats.objects_freed, _stats.bytes_freed);
+    std::cout << fmt::format("major pause:       {:.3f} ms total, {:.3f} ms max, {:.3f} ms target\n",
+                             _stats.total_pause_ns / 1e6, _stats.max_pause_ns / 1e6, _pause_target_ns / 1e6);
+    std::cout << fmt::format("old generation:    {} objects ({} bytes)\n", _objects.size(), _bytes_allocated);
+    std::cout << fmt::format("nursery:           {} of {} bytes used\n", _nursery_top - _nursery, nursery_size);
+
+    std::cout << "pauses:\n";
+    for (usize i = 0; i < PauseHistogram::bucket_count; i++) {
+        u64 count = _stats.pauses.buckets[i];
+        if (count == 0)
+            continue;
+
+        if (i == PauseHistogram::bucket_count - 1)
+            std::cout << fmt::format("  >= {:>8} us: {}\n", PauseHistogram::bucket_limit_us(i - 1), count);
+        else
+            std::cout << fmt::format("  <  {:>8} us: {}\n", PauseHistogram::bucket_limit_us(i), count);
+    }
+
+    std::cout << "--------------------------\n";
+}
+
+Heap::NoCollection::NoCollection() {
+    Heap::instance()._no_collection++;
+}
+
+Heap::NoCollection::~NoCollection() {
+    Heap::instance()._no_collection--;
+}
+
+} // namespace script
@@ -7,15 +7,47 @@
 #include "common/exception.hpp"
 #include "common/finally.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fmt/core.h>
 
 namespace script {
 
+// Result of a fused binary expression once its local holds a number, none of the fused operators can fail then.
+static ScriptObject number_binary(u32 op, f64 a, f64 b) {
+    switch (op) {
+    case TokenType::TT_PLUS:
+        return ScriptObject(a + b);
+    case TokenType::TT_MINUS:
+        return ScriptObject(a - b);
+    case TokenType::TT_STAR:
+        return ScriptObject(a * b);
+    case TokenType::TT_GREATER:
+        return ScriptObject(a > b);
+    case TokenType::TT_GREATER_EQUAL:
+        return ScriptObject(a >= b);
+    case TokenType::TT_LESS:
+        return ScriptObject(a < b);
+    default:
+        return ScriptObject(a <= b);
+    }
+}
+
 Interpreter::Interpreter() {
-    _global_env.set_name("global_scope");
-    _current_env = &_global_env;
+    _global_env = std::make_shared<ScriptEnvironment>();
     _control_flow_state = ControlFlowState::None;
+    _stack = std::make_unique<ScriptObject[]>(stack_size);
+    _stack_top = _stack.get();
+    _stack_end = _stack.get() + stack_size;
+    _frame = nullptr;
+    _function = nullptr;
+    _call_depth = 0;
+
+    Heap::instance().add_roots(this);
+}
+
+Interpreter::~Interpreter() {
+    Heap::instance().remove_roots(this);
 }
 
 void Interpreter::interpret(Node* node) {
@@ -23,38 +55,16 @@ void Interpreter::interpret(Node* node) {
         node->accept(this);
     } catch (const RuntimeError& e) {
         std::cerr << "[runtime error]: " << e.what() << "\n";
-    }
-}
 
-void Interpreter::resolve(Expr* expr, usize depth) {
-    _locals[expr] = depth;
+        // temporaries of the statement that failed outside of any frame
+        _stack_top = _stack.get();
+    }
 }
 
 void Interpreter::visit_print_stmt(PrintStmt* stmt) {
     auto variable = evaluate(stmt->expr.get());
 
-    std::cout << "[runtime]: ";
-
-    if (variable.type == ScriptObjectType::Nil) {
-        std::cout << "nil";
-    } else if (variable.type == ScriptObjectType::Boolean) {
-        std::cout << (std::get<bool>(variable.value) ? "true" : "false");
-    } else if (variable.type == ScriptObjectType::Number) {
-        std::cout << std::get<f64>(variable.value);
-    } else if (variable.type == ScriptObjectType::String) {
-        std::cout << std::get<std::string>(variable.value);
-    } else if (variable.type == ScriptObjectType::Callable) {
-        auto callable = std::get<Arc<ScriptCallable>>(variable.value);
-        std::cout << callable->to_string();
-    } else if (variable.type == ScriptObjectType::Class) {
-        auto klass = std::get<Arc<ScriptClass>>(variable.value);
-        std::cout << klass->to_string();
-    } else if (variable.type == ScriptObjectType::ClassInstance) {
-        auto klass_instance = std::get<Arc<ScriptClassInstance>>(variable.value);
-        std::cout << klass_instance->to_string();
-    }
-
-    std::cout << "\n";
+    std::cout << "[runtime]: " << variable << "\n";
 }
 
 void Interpreter::visit_expr_stmt(ExprStmt* stmt) {
@@ -67,24 +77,38 @@ void Interpreter::visit_var_stmt(VarStmt* stmt) {
     if (stmt->initializer)
         object = evaluate(stmt->initializer.get());
 
-    _current_env->define_variable(stmt->name.value, object);
+    define_variable(stmt->name, stmt->location, object);
 }
 
 void Interpreter::visit_block_stmt(BlockStmt* stmt) {
-    static i32 counter = 0; // TODO: clean
-
     if (_control_flow_state != ControlFlowState::None)
         return;
 
-    auto environment = std::make_shared<ScriptEnvironment>(_current_env);
-    environment->set_name(fmt::format("block_scope_{}", counter));
-    execute_block(stmt->statements, environment);
+    // variables of blocks inside a function or another block already have their slots in the current frame
+    if (_frame) {
+        execute_statements(stmt->statements);
+        if (stmt->closes_upvalues)
+            _open_upvalues.close(_frame + stmt->first_slot);
+        return;
+    }
+
+    ScriptObject* frame = _stack_top;
+
+    // defer this
+    auto _ = oso::finally([&] {
+        pop_frame(frame);
+        _frame = nullptr;
+    });
+
+    _stack_top += stmt->frame_size;
+    std::fill(frame, _stack_top, ScriptObject());
+
+    _frame = frame;
+    execute_statements(stmt->statements);
 }
 
 void Interpreter::visit_if_stmt(IfStmt* stmt) {
-    ScriptObject object = evaluate(stmt->condition.get());
-
-    if (is_true(object))
+    if (condition_holds(stmt->condition.get(), stmt->fusion))
         execute(stmt->then_branch.get());
     else if (stmt->else_branch)
         execute(stmt->else_branch.get());
@@ -93,7 +117,7 @@ void Interpreter::visit_if_stmt(IfStmt* stmt) {
 void Interpreter::visit_while_stmt(WhileStmt* stmt) {
     Node* condition = stmt->condition.get();
 
-    while (is_true(evaluate(condition))) {
+    while (condition_holds(condition, stmt->fusion)) {
         execute(stmt->body.get());
 
         if (_control_flow_state == ControlFlowState::Break || _control_flow_state == ControlFlowState::Return) {
@@ -110,80 +134,72 @@ void Interpreter::visit_break_stmt(BreakStmt* stmt) {
 }
 
 void Interpreter::visit_function_stmt(FunctionStmt* stmt) {
-    ScriptObject function;
-    function.type = ScriptObjectType::Callable;
-
-    auto closure = std::make_shared<ScriptEnvironment>(_current_env);
-    function.value = std::make_shared<ScriptFunction>(stmt, closure, stmt->name.type == TT_INVALID);
-
-    if (stmt->name.type == TokenType::TT_INVALID) {
-        stmt->name.value = "$anon";
-        closure->define_variable(stmt->name.value, function);
-    } else {
-        _current_env->define_variable(stmt->name.value, function);
+    auto function = create_object<ScriptFunction>(stmt, stmt->name.type == TT_INVALID);
+
+    auto& upvalues = function.as<ScriptFunction>()->upvalues;
+    for (usize i = 0; i < upvalues.size(); i++) {
+        auto& captured = stmt->upvalues[i];
+        if (captured.is_local)
+            upvalues[i] = _open_upvalues.capture(_frame + captured.index);
+        else
+            upvalues[i] = _function->upvalues[captured.index];
     }
 
-    closure->set_name(fmt::format("function_scope_{}", stmt->name.value));
-
-    push_variable(ScriptObjectType::Callable, function);
+    // anonymous functions are expressions and are not bound to a name
+    if (stmt->name.type != TokenType::TT_INVALID)
+        define_variable(stmt->name, stmt->location, function);
+    else
+        push(function);
 }
 
 void Interpreter::visit_return_stmt(ReturnStmt* stmt) {
-    if (stmt->expr) {
-        evaluate(stmt->expr.get());
-    }
+    // the slot of the callee below the frame holds the result until the call returns
+    _frame[-1] = stmt->expr ? evaluate(stmt->expr.get()) : ScriptObject();
 
     _control_flow_state = ControlFlowState::Return;
 }
 
 void Interpreter::visit_class_stmt(ClassStmt* stmt) {
-    ScriptObject klass;
-    klass.type = ScriptObjectType::Class;
-
-    _current_env->define_variable(stmt->name.value, klass);
-    klass.value = std::make_shared<ScriptClass>(stmt->name.value); // TODO: Arc::make<ScriptClass>
-    _current_env->assign_variable(stmt->name, klass);
+    auto klass = create_object<ScriptClass>(std::string(stmt->name.value));
+    define_variable(stmt->name, stmt->location, klass);
 }
 
 void Interpreter::visit_unary_expr(UnaryExpr* node) {
     auto variable = evaluate(node->expr.get());
     if (node->op.type == TokenType::TT_MINUS) {
         assert_object_type(node->op, ScriptObjectType::Number, variable);
-        variable.value = -std::get<f64>(variable.value);
+        variable = ScriptObject(-variable.as_number());
     } else if (node->op.type == TokenType::TT_BANG) {
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = !is_true(variable);
+        variable = ScriptObject(!is_true(variable));
     }
 
-    push_variable(variable.type, variable);
+    push(variable);
 }
 
 void Interpreter::visit_binary_expr(BinaryExpr* node) {
-    auto left = evaluate(node->left.get());
-    auto right = evaluate(node->right.get());
+    if (node->fusion == Fusion::LocalNumber && _frame[node->slot].is_number()) {
+        push(number_binary(node->op.type, _frame[node->slot].as_number(), node->number));
+        return;
+    }
+
+    // both operands stay on the stack until the result replaces them
+    node->left->accept(this);
+    node->right->accept(this);
+    ScriptObject left = _stack_top[-2];
+    ScriptObject right = _stack_top[-1];
 
     ScriptObject variable;
 
     switch (node->op.type) {
     case TokenType::TT_PLUS: {
-        if (left.type == ScriptObjectType::Number) {
-            if (right.type == ScriptObjectType::String) {
-                variable.type = ScriptObjectType::String;
-                variable.value = fmt::format("{}", std::get<f64>(left.value)) + std::get<std::string>(right.value);
-                break;
-            }
-            assert_object_type(node->op, ScriptObjectType::Number, right);
-            variable.type = ScriptObjectType::Number;
-            variable.value = std::get<f64>(left.value) + std::get<f64>(right.value);
-        } else if (left.type == ScriptObjectType::String) {
-            if (right.type == ScriptObjectType::Number) {
-                variable.type = ScriptObjectType::String;
-                variable.value = std::get<std::string>(left.value) + fmt::format("{}", std::get<f64>(right.value));
-                break;
-            }
-            assert_object_type(node->op, ScriptObjectType::String, right);
-            variable.type = ScriptObjectType::String;
-            variable.value = std::get<std::string>(left.value) + std::get<std::string>(right.value);
+        if (left.is_number() && right.is_number()) {
+            variable = ScriptObject(left.as_number() + right.as_number());
+        } else if (left.is_number() || left.is_object_type(ScriptObjectType::String)) {
+            if (!right.is_number())
+                assert_object_type(node->op, ScriptObjectType::String, right);
+
+            // the operands are read again after the result was allocated
+            variable = concatenate(_stack_top[-2], _stack_top[-1]);
         } else {
             throw RuntimeError(node->op, "only numbers and strings are allowed for binary expressions");
             return;
@@ -191,177 +207,237 @@ void Interpreter::visit_binary_expr(BinaryExpr* node) {
     } break;
     case TokenType::TT_MINUS:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Number;
-        variable.value = std::get<f64>(left.value) - std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() - right.as_number());
         break;
     case TokenType::TT_STAR:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Number;
-        variable.value = std::get<f64>(left.value) * std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() * right.as_number());
         break;
     case TokenType::TT_SLASH: {
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        f64 lhs_value = std::get<f64>(left.value);
-        f64 rhs_value = std::get<f64>(right.value);
+        f64 lhs_value = left.as_number();
+        f64 rhs_value = right.as_number();
         if (lhs_value == 0.0 || rhs_value == 0.0) {
             throw RuntimeError(node->op, "division by zero is not allowed");
             return;
         }
-        variable.type = ScriptObjectType::Number;
-        variable.value = lhs_value / rhs_value;
+        variable = ScriptObject(lhs_value / rhs_value);
     } break;
     case TokenType::TT_GREATER:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = std::get<f64>(left.value) > std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() > right.as_number());
         break;
     case TokenType::TT_GREATER_EQUAL:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = std::get<f64>(left.value) >= std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() >= right.as_number());
         break;
     case TokenType::TT_LESS:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = std::get<f64>(left.value) < std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() < right.as_number());
         break;
     case TokenType::TT_LESS_EQUAL:
         assert_objects_type(node->op, ScriptObjectType::Number, left, right);
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = std::get<f64>(left.value) <= std::get<f64>(right.value);
+        variable = ScriptObject(left.as_number() <= right.as_number());
         break;
     case TokenType::TT_BANG_EQUAL:
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = !is_equal(left, right);
+        variable = ScriptObject(!is_equal(left, right));
         break;
     case TokenType::TT_EQUAL_EQUAL:
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = is_equal(left, right);
+        variable = ScriptObject(is_equal(left, right));
         break;
     default:
         throw RuntimeError(node->op, "unknown binary expression operator");
         break;
     }
 
-    push_variable(variable.type, variable);
+    pop();
+    _stack_top[-1] = variable;
 }
 
 void Interpreter::visit_grouping_expr(GroupingExpr* node) {
-    evaluate(node->expr.get());
+    node->expr->accept(this);
 }
 
 void Interpreter::visit_literal_expr(LiteralExpr* node) {
     ScriptObject variable;
 
-    if (node->literal_type == LiteralExpr::LiteralType::Nil) {
-        variable.type = ScriptObjectType::Nil;
-    } else if (node->literal_type == LiteralExpr::LiteralType::Boolean) {
-        variable.type = ScriptObjectType::Boolean;
-        variable.value = std::get<bool>(node->value);
+    if (node->literal_type == LiteralExpr::LiteralType::Boolean) {
+        variable = ScriptObject(std::get<bool>(node->value));
     } else if (node->literal_type == LiteralExpr::LiteralType::Number) {
-        variable.type = ScriptObjectType::Number;
-        variable.value = std::get<f64>(node->value);
+        variable = ScriptObject(std::get<f64>(node->value));
     } else if (node->literal_type == LiteralExpr::LiteralType::String) {
-        variable.type = ScriptObjectType::String;
-        variable.value = std::get<std::string>(node->value);
+        variable = ScriptObject(std::get<ScriptString*>(node->value));
     }
 
-    push_variable(variable.type, variable);
+    push(variable);
 }
 
 void Interpreter::visit_logical_expr(LogicalExpr* node) {
-    ScriptObject left_result = evaluate(node->left.get());
+    // the left operand stays on the stack when it decides the result
+    node->left->accept(this);
+    bool left_result = is_true(_stack_top[-1]);
 
-    // TODO: modify the top of the stack? prob not needed
     if (node->op.type == TokenType::TT_OR) {
-        if (is_true(left_result))
+        if (left_result)
             return;
     } else {
-        if (!is_true(left_result))
+        if (!left_result)
             return;
     }
 
-    evaluate(node->right.get());
+    pop();
+    node->right->accept(this);
 }
 
 void Interpreter::visit_conditional_expr(ConditionalExpr* node) {
-    auto result = evaluate(node->expr.get());
-
-    if (is_true(result))
-        evaluate(node->left.get());
+    if (is_true(evaluate(node->expr.get())))
+        node->left->accept(this);
     else
-        evaluate(node->right.get());
+        node->right->accept(this);
 }
 
 void Interpreter::visit_variable_expr(VariableExpr* node) {
-    auto result = lookup_variable(node->name, node);
-    push_variable(result.type, result);
+    auto result = lookup_variable(node->name, node->location);
+    push(result);
 }
 
 void Interpreter::visit_assignment_expr(AssignmentExpr* node) {
+    if (node->fusion == Fusion::LocalIncrement) {
+        auto& local = _frame[node->location.slot];
+        if (local.is_number()) {
+            local = ScriptObject(local.as_number() + static_cast<BinaryExpr*>(node->value.get())->number);
+            push(local);
+            return;
+        }
+    }
+
     auto value = evaluate(node->value.get());
 
-    if (_locals.contains(node)) {
-        usize distance = _locals[node];
-        _current_env->assign_variable_at(distance, node->name, value);
-        return;
+    switch (node->location.kind) {
+    case VariableLocation::Global:
+        _global_env->assign_variable(node->name, value);
+        break;
+    case VariableLocation::Local:
+        _frame[node->location.slot] = value;
+        break;
+    case VariableLocation::Upvalue: {
+        auto& upvalue = _function->upvalues[node->location.slot];
+        *upvalue->location = value;
+        Heap::instance().write_barrier(upvalue);
+    } break;
     }
 
-    _global_env.assign_variable(node->name, value);
+    push(value);
 }
 
 void Interpreter::visit_call_expr(CallExpr* node) {
-    ScriptObject callee = evaluate(node->callee.get());
-    if (callee.type != ScriptObjectType::Callable && callee.type != ScriptObjectType::Class) {
+    // the callee and the arguments are left on the stack, they become the frame of the call
+    node->callee->accept(this);
+    ScriptObject* callee = _stack_top - 1;
+    if (!callee->is_object_type(ScriptObjectType::Callable) && !callee->is_object_type(ScriptObjectType::Class)) {
         throw RuntimeError(node->paren, "Can only call functions and classes");
     }
 
-    std::vector<ScriptObject> arguments;
     for (auto& arg : node->arguments) {
-        arguments.push_back(evaluate(arg.get()));
+        arg->accept(this);
     }
 
-    ScriptCallable* callable = callee.type == ScriptObjectType::Callable
-                                   ? std::get<Arc<ScriptCallable>>(callee.value).get()
-                                   : std::get<Arc<ScriptClass>>(callee.value).get();
+    auto* callable = callee->as<ScriptCallable>();
+    usize arg_count = node->arguments.size();
 
-    if (arguments.size() != callable->arity) {
+    if (arg_count != callable->arity) {
         throw RuntimeError(node->paren,
-                           fmt::format("Expected {0} arguments but got {1}.", callable->arity, arguments.size()));
+                           fmt::format("Expected {0} arguments but got {1}.", callable->arity, arg_count));
+    }
+
+    ScriptObject result;
+    if (callable->callable_type == ScriptCallableType::Function) {
+        result = call_function(static_cast<ScriptFunction*>(callable), static_cast<u8>(arg_count));
+    } else {
+        // builtins and classes take their arguments as a vector, the stack keeps them reachable during the call
+        std::vector<ScriptObject> arguments(_stack_top - arg_count, _stack_top);
+        result = callable->call(this, arguments);
+        _stack_top -= arg_count + 1;
     }
 
-    auto result = callable->call(this, arguments);
-    push_variable(result.type, result);
+    push(result);
 }
 
 void Interpreter::visit_get_expr(GetExpr* node) {
-    ScriptObject obj = evaluate(node->object.get());
-    if (obj.type != ScriptObjectType::ClassInstance) {
+    ScriptObject obj = node->fusion == Fusion::LocalProperty ? _frame[node->slot] : evaluate(node->object.get());
+    if (!obj.is_object_type(ScriptObjectType::ClassInstance)) {
         throw RuntimeError(node->name, "Only class instances have properties");
     }
 
-    auto instance = std::get<Arc<ScriptClassInstance>>(obj.value);
+    auto* instance = obj.as<ScriptClassInstance>();
+    auto& cache = node->cache;
+
+    for (u32 i = 0; i < cache.size; i++) {
+        if (cache.entries[i].shape == instance->shape) {
+            cache.hits++;
+            auto& field = instance->field(cache.entries[i].slot);
+            push(field);
+            return;
+        }
+    }
+
+    record_cache_miss(cache, node->name, false);
 
-    auto field = instance->get(node->name);
-    push_variable(field.type, field);
+    i32 slot = instance->shape->find_field(node->name.string);
+    if (slot < 0) {
+        throw RuntimeError(node->name, "Undefined property '" + std::string(node->name.value) + "'");
+    }
+
+    if (cache.size < InlineCache::max_entries) {
+        cache.entries[cache.size++] = { instance->shape, nullptr, static_cast<u32>(slot) };
+    }
+
+    auto& field = instance->field(slot);
+    push(field);
 }
 
 void Interpreter::visit_set_expr(SetExpr* node) {
-    ScriptObject obj = evaluate(node->object.get());
-    if (obj.type != ScriptObjectType::ClassInstance) {
+    // the instance stays on the stack, it may move while the value is evaluated
+    node->object->accept(this);
+    if (!_stack_top[-1].is_object_type(ScriptObjectType::ClassInstance)) {
         throw RuntimeError(node->name, "Only class instances have fields");
     }
 
-    auto instance = std::get<Arc<ScriptClassInstance>>(obj.value);
-
     auto value = evaluate(node->value.get());
-    instance->set(node->name, value);
+    auto* instance = pop().as<ScriptClassInstance>();
+
+    Heap::instance().write_barrier(instance, value);
+    auto& cache = node->cache;
+
+    for (u32 i = 0; i < cache.size; i++) {
+        auto& entry = cache.entries[i];
+        if (entry.shape != instance->shape)
+            continue;
+
+        cache.hits++;
+        if (entry.transition)
+            instance->add_field(entry.transition, value);
+        else
+            instance->field(entry.slot) = value;
+
+        push(value);
+        return;
+    }
+
+    record_cache_miss(cache, node->name, true);
+
+    Shape* shape = instance->shape;
+    u32 slot = instance->set(node->name.string, value);
+
+    if (cache.size < InlineCache::max_entries) {
+        cache.entries[cache.size++] = { shape, instance->shape != shape ? instance->shape : nullptr, slot };
+    }
 
-    push_variable(value.type, value);
+    push(value);
 }
 
 ScriptEnvironment& Interpreter::global_env() {
-    return _global_env;
+    return *_global_env;
 }
 
 ControlFlowState Interpreter::control_flow_state() {
@@ -372,81 +448,172 @@ void Interpreter::set_control_flow_state(ControlFlowState state) {
     _control_flow_state = state;
 }
 
-ScriptObject& Interpreter::expr_result() {
-    return _expr_result;
-}
-
 ScriptObject Interpreter::evaluate(Node* expr) {
     expr->accept(this);
-    return _expr_result;
+    return pop();
+}
+
+bool Interpreter::condition_holds(Node* condition, Fusion fusion) {
+    if (fusion == Fusion::LocalNumber) {
+        auto* binary = static_cast<BinaryExpr*>(condition);
+        if (_frame[binary->slot].is_number())
+            return is_true(number_binary(binary->op.type, _frame[binary->slot].as_number(), binary->number));
+    }
+
+    return is_true(evaluate(condition));
 }
 
 void Interpreter::execute(Stmt* stmt) {
     stmt->accept(this);
 }
 
-void Interpreter::execute_block(std::vector<Node::ptr>& statements, std::shared_ptr<ScriptEnvironment> environment) {
-    ScriptEnvironment* previous_env = _current_env;
+void Interpreter::execute_statements(std::vector<Node::ptr>& statements) {
+    for (auto& stmt : statements) {
+        // the parser appends the increment of a 'for' loop as a bare expression to the loop body, its value is dropped
+        if (stmt->type() <= Node::Type::SetExpr)
+            evaluate(stmt.get());
+        else
+            execute(reinterpret_cast<Stmt*>(stmt.get()));
+
+        if (_control_flow_state != ControlFlowState::None)
+            break;
+    }
+}
+
+ScriptObject Interpreter::call_function(ScriptFunction* function, u8 arg_count) {
+    FunctionStmt* decl = function->decl;
+    ScriptObject* frame = _stack_top - arg_count;
+
+    if (_call_depth >= max_call_depth || decl->frame_size > static_cast<usize>(_stack_end - frame)) {
+        throw RuntimeError(decl->name, "Stack overflow");
+    }
+
+    for (u8 i = 0; i < arg_count; i++) {
+        auto& arg = frame[i];
+        auto& param = decl->params.at(i);
+
+        // rename anonymous function to param name if possible
+        if (arg.is_object_type(ScriptObjectType::Callable)) {
+            auto* callable = arg.as<ScriptCallable>();
+            if (callable->callable_type == ScriptCallableType::Function) {
+                auto* func = static_cast<ScriptFunction*>(callable);
+                if (func->anonymous) {
+                    func->decl->name.value = param.value;
+                    func->decl->name.string = param.string;
+                }
+            }
+        }
+    }
+
+    ScriptObject* previous_frame = _frame;
+    ScriptFunction* previous_function = _function;
 
     // defer this
+    _call_depth++;
     auto _ = oso::finally([&] {
-        _current_env = previous_env;
+        // the callee sits right below the frame
+        pop_frame(frame - 1);
+        _frame = previous_frame;
+        _function = previous_function;
+        _call_depth--;
     });
 
-    _current_env = environment.get();
-    for (auto& stmt : statements) {
-        execute(reinterpret_cast<Stmt*>(stmt.get()));
-        if (_control_flow_state != ControlFlowState::None)
-            break;
+    // slots past the arguments may still hold values of an earlier frame
+    _stack_top = frame + decl->frame_size;
+    std::fill(frame + arg_count, _stack_top, ScriptObject());
+
+    _frame = frame;
+    _function = function;
+    execute_statements(decl->body);
+
+    if (_control_flow_state == ControlFlowState::Return) {
+        _control_flow_state = ControlFlowState::None;
+        return frame[-1];
     }
+
+    return ScriptObject();
 }
 
-void Interpreter::push_variable(u8 type, ScriptObject& value) {
-    if (type != value.type) {
-        // TODO: runtime error
+void Interpreter::stack_overflow() {
+    throw RuntimeError(Token(TT_INVALID, 0), "Stack overflow");
+}
+
+void Interpreter::mark_roots(Heap& heap) {
+    for (ScriptObject* slot = _stack.get(); slot != _stack_top; slot++) {
+        heap.mark(*slot);
     }
 
-    _expr_result = value;
+    _global_env->mark(heap);
 }
 
-ScriptObject Interpreter::lookup_variable(Token& name, Expr* expr) {
-    if (_locals.contains(expr)) {
-        usize distance = _locals[expr];
-        return _current_env->find_variable_at(distance, name);
+void Interpreter::pop_frame(ScriptObject* frame) {
+    _open_upvalues.close(frame);
+    _stack_top = frame;
+}
+
+void Interpreter::define_variable(Token& name, VariableLocation location, ScriptObject& value) {
+    // declarations are either globals or locals of the current frame
+    if (location.kind == VariableLocation::Global)
+        _global_env->define_variable(name.string, value);
+    else
+        _frame[location.slot] = value;
+}
+
+ScriptObject Interpreter::lookup_variable(Token& name, VariableLocation location) {
+    switch (location.kind) {
+    case VariableLocation::Local:
+        return _frame[location.slot];
+    case VariableLocation::Upvalue:
+        return *_function->upvalues[location.slot]->location;
+    default:
+        return _global_env->find_variable(name);
+    }
+}
+
+void Interpreter::record_cache_miss(InlineCache& cache, Token& name, bool store) {
+    // the first run of a site is always a miss
+    if (cache.hits == 0 && cache.misses == 0) {
+        _property_sites.push_back({ &name, store, &cache });
+    }
+
+    cache.misses++;
+}
+
+void Interpreter::print_inline_cache_stats() {
+    std::cout << "-------- INLINE CACHE STATS --------\n";
+    for (auto& site : _property_sites) {
+        auto* cache = site.cache;
+
+        const char* state = "monomorphic";
+        if (cache->size == InlineCache::max_entries && cache->misses > cache->size)
+            state = "megamorphic";
+        else if (cache->size > 1)
+            state = "polymorphic";
+
+        f64 hit_rate = 100.0 * cache->hits / (cache->hits + cache->misses);
+        std::cout << fmt::format("line {:<5} {} '{}': {} hits, {} misses ({:.2f}%), {}\n", site.name->line,
+                                 site.store ? "set" : "get", site.name->value, cache->hits, cache->misses, hit_rate,
+                                 state);
     }
-    return _global_env.find_variable(name);
+    std::cout << "------------------------------------\n";
 }
 
-bool Interpreter::is_true(ScriptObject variable) {
-    if (variable.type == ScriptObjectType::Nil)
-        return false;
-    else if (variable.type == ScriptObjectType::Boolean)
-        return std::get<bool>(variable.value);
-    return true;
+const GcStats& Interpreter::gc_stats() const {
+    return Heap::instance().stats();
 }
 
-bool Interpreter::is_equal(ScriptObject a, ScriptObject b) {
-    if (a.type != b.type)
-        return false;
-    else if (a.type == ScriptObjectType::Nil && b.type == ScriptObjectType::Nil)
-        return true;
-    else if (a.type == ScriptObjectType::Nil)
-        return false;
-    else if (a.type == ScriptObjectType::Number)
-        return std::get<f64>(a.value) == std::get<f64>(b.value);
-    else if (a.type == ScriptObjectType::String)
-        return std::get<std::string>(a.value) == std::get<std::string>(b.value);
-    return false;
+void Interpreter::set_gc_pause_target(u64 microseconds) {
+    Heap::instance().set_pause_target(microseconds * 1000);
 }
 
 void Interpreter::assert_object_type(Token& op, ScriptObjectType type, ScriptObject& variable) {
-    if (variable.type == type)
+    if (variable.type() == type)
         return;
     throw RuntimeError(op, "variable type mismatch");
 }
 
 void Interpreter::assert_objects_type(Token& op, ScriptObjectType type, ScriptObject& a, ScriptObject& b) {
-    if (a.type == type && b.type == type)
+    if (a.type() == type && b.type() == type)
         return;
     throw RuntimeError(op, "variable type mismatch");
 }
@@ -1,20 +1,227 @@
 #include "script/lexer.hpp"
+
+#include <bit>
 #include <iostream>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace script {
 
-Lexer::Lexer(const std::string& buffer)
+// Scanning of whitespace, comments, identifiers, numbers and strings tests a whole vector of bytes at a time where the
+// target supports it (AVX2 when the compiler targets it, SSE2 otherwise on x86-64). The rest of the buffer that doesn't
+// fill a vector is handled by the scalar loops.
+#if defined(__AVX2__)
+#define LEXER_SIMD 1
+using Vector = __m256i;
+static constexpr usize vector_size = 32;
+static constexpr u32 full_mask = 0xffffffff;
+
+static Vector load(const char* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+static Vector splat(char c) {
+    return _mm256_set1_epi8(c);
+}
+
+static u32 mask_eq(Vector v, char c) {
+    return static_cast<u32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, splat(c))));
+}
+
+// Signed compares, so bytes outside of ASCII are never in range.
+static u32 mask_in_range(Vector v, char low, char high) {
+    Vector above = _mm256_cmpgt_epi8(v, splat(low - 1));
+    Vector below = _mm256_cmpgt_epi8(splat(high + 1), v);
+    return static_cast<u32>(_mm256_movemask_epi8(_mm256_and_si256(above, below)));
+}
+
+static Vector fold_case(Vector v) {
+    return _mm256_or_si256(v, splat(0x20));
+}
+#elif defined(__SSE2__)
+#define LEXER_SIMD 1
+using Vector = __m128i;
+static constexpr usize vector_size = 16;
+static constexpr u32 full_mask = 0xffff;
+
+static Vector load(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+static Vector splat(char c) {
+    return _mm_set1_epi8(c);
+}
+
+static u32 mask_eq(Vector v, char c) {
+    return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, splat(c))));
+}
+
+// Signed compares, so bytes outside of ASCII are never in range.
+static u32 mask_in_range(Vector v, char low, char high) {
+    Vector above = _mm_cmpgt_epi8(v, splat(low - 1));
+    Vector below = _mm_cmpgt_epi8(splat(high + 1), v);
+    return static_cast<u32>(_mm_movemask_epi8(_mm_and_si128(above, below)));
+}
+
+static Vector fold_case(Vector v) {
+    return _mm_or_si128(v, splat(0x20));
+}
+#endif
+
+static constexpr usize scalar_prefix = 8;
+
+static bool is_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Returns the position of the first byte at or after `pos` for which `stop` holds, or the end of the buffer.
+// `vector_stop` returns the mask of such bytes within a vector.
+template<typename VectorStop, typename ScalarStop>
+static usize scan_until(std::string_view buffer, usize pos, VectorStop vector_stop, ScalarStop stop) {
+#if defined(LEXER_SIMD)
+    // Most tokens are short, only runs longer than a few bytes are worth a vector load.
+    for (usize end = std::min(pos + scalar_prefix, buffer.size()); pos < end; pos++) {
+        if (stop(buffer[pos]))
+            return pos;
+    }
+
+    while (pos + vector_size <= buffer.size()) {
+        u32 mask = vector_stop(load(buffer.data() + pos));
+        if (mask)
+            return pos + std::countr_zero(mask);
+        pos += vector_size;
+    }
+#endif
+
+    while (pos < buffer.size() && !stop(buffer[pos]))
+        pos++;
+    return pos;
+}
+
+static usize scan_identifier(std::string_view buffer, usize pos) {
+    return scan_until(
+        buffer, pos,
+        [](auto v) {
+#if defined(LEXER_SIMD)
+            u32 alpha = mask_in_range(fold_case(v), 'a', 'z');
+            u32 digit = mask_in_range(v, '0', '9');
+            return ~(alpha | digit | mask_eq(v, '_')) & full_mask;
+#endif
+        },
+        [](char c) { return !is_identifier_char(c); });
+}
+
+static usize scan_digits(std::string_view buffer, usize pos) {
+    return scan_until(
+        buffer, pos,
+        [](auto v) {
+#if defined(LEXER_SIMD)
+            return ~mask_in_range(v, '0', '9') & full_mask;
+#endif
+        },
+        [](char c) { return c < '0' || c > '9'; });
+}
+
+// Finds the end of a string literal body: the closing quote or the newline that leaves it unterminated.
+static usize scan_string(std::string_view buffer, usize pos) {
+    return scan_until(
+        buffer, pos,
+        [](auto v) {
+#if defined(LEXER_SIMD)
+            return mask_eq(v, '"') | mask_eq(v, '\n');
+#endif
+        },
+        [](char c) { return c == '"' || c == '\n'; });
+}
+
+static usize scan_line_end(std::string_view buffer, usize pos) {
+    return scan_until(
+        buffer, pos,
+        [](auto v) {
+#if defined(LEXER_SIMD)
+            return mask_eq(v, '\n');
+#endif
+        },
+        [](char c) { return c == '\n'; });
+}
+
+static u32 check_keyword(std::string_view name, usize start, std::string_view rest, TokenType type) {
+    if (name.size() == start + rest.size() && name.substr(start) == rest)
+        return type;
+    return TT_IDENTIFIER;
+}
+
+// Classifies an identifier by switching on its first characters, so at most one keyword is ever compared.
+static u32 keyword_type(std::string_view name) {
+    switch (name[0]) {
+    case 'a':
+        return check_keyword(name, 1, "nd", TT_AND);
+    case 'b':
+        return check_keyword(name, 1, "reak", TT_BREAK);
+    case 'c':
+        return check_keyword(name, 1, "lass", TT_CLASS);
+    case 'e':
+        return check_keyword(name, 1, "lse", TT_ELSE);
+    case 'f':
+        if (name.size() > 1) {
+            switch (name[1]) {
+            case 'a':
+                return check_keyword(name, 2, "lse", TT_FALSE);
+            case 'o':
+                return check_keyword(name, 2, "r", TT_FOR);
+            case 'u':
+                return check_keyword(name, 2, "n", TT_FUN);
+            }
+        }
+        break;
+    case 'i':
+        return check_keyword(name, 1, "f", TT_IF);
+    case 'n':
+        return check_keyword(name, 1, "il", TT_NIL);
+    case 'o':
+        return check_keyword(name, 1, "r", TT_OR);
+    case 'p':
+        return check_keyword(name, 1, "rint", TT_PRINT);
+    case 'r':
+        return check_keyword(name, 1, "eturn", TT_RETURN);
+    case 's':
+        return check_keyword(name, 1, "uper", TT_SUPER);
+    case 't':
+        if (name.size() > 1) {
+            switch (name[1]) {
+            case 'h':
+                return check_keyword(name, 2, "is", TT_THIS);
+            case 'r':
+                return check_keyword(name, 2, "ue", TT_TRUE);
+            }
+        }
+        break;
+    case 'v':
+        return check_keyword(name, 1, "ar", TT_VAR);
+    case 'w':
+        return check_keyword(name, 1, "hile", TT_WHILE);
+    }
+
+    return TT_IDENTIFIER;
+}
+
+Lexer::Lexer(std::string_view buffer)
     : _buffer(buffer),
-      _current(0),
+      _buffer_size(buffer.size()),
+      _error(false),
       _start(0),
+      _current(0),
       _line(1),
-      _error(false) {
-    _buffer_size = buffer.size();
+      _line_start(0) {
 }
 
 void Lexer::error(const std::string& msg) {
     _error = true;
-    std::cerr << "[lexer error]: " << msg << " at line " << _line << ", col " << _column << "\n";
+    std::cerr << "[lexer error]: " << msg << " at line " << _line << ", col " << _current - _line_start << "\n";
 }
 
 void Lexer::print() {
@@ -31,23 +238,16 @@ void Lexer::print() {
 
 Token Lexer::next() {
     while (true) {
+        skip_whitespace();
+
         _start = _current;
 
         char c = advance();
 
         switch (c) {
-        case ' ':
-        case '\r':
-        case '\t':
-            break;
-        case '\n':
-            _line++;
-            _column = 0;
-            break;
         case '/':
             if (peek() == '/') {
-                while (peek() != '\n' && !is_eof())
-                    advance();
+                _current = scan_line_end(_buffer, _current);
                 break;
             }
             return Token(TT_SLASH, _line);
@@ -113,6 +313,53 @@ Token Lexer::next() {
     }
 }
 
+void Lexer::skip_whitespace() {
+#if defined(LEXER_SIMD)
+    for (usize end = std::min(_current + scalar_prefix, _buffer_size); _current < end; _current++) {
+        char c = _buffer[_current];
+        if (c == '\n') {
+            _line++;
+            _line_start = _current + 1;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            return;
+        }
+    }
+
+    while (_current + vector_size <= _buffer_size) {
+        Vector v = load(_buffer.data() + _current);
+        u32 newlines = mask_eq(v, '\n');
+        u32 stop = ~(newlines | mask_eq(v, ' ') | mask_eq(v, '\t') | mask_eq(v, '\r')) & full_mask;
+
+        // Only the newlines in front of the first byte that isn't whitespace are skipped.
+        if (stop)
+            newlines &= (1u << std::countr_zero(stop)) - 1;
+
+        if (newlines) {
+            _line += std::popcount(newlines);
+            _line_start = _current + (31 - std::countl_zero(newlines)) + 1;
+        }
+
+        if (stop) {
+            _current += std::countr_zero(stop);
+            return;
+        }
+
+        _current += vector_size;
+    }
+#endif
+
+    while (!is_eof()) {
+        char c = _buffer[_current];
+        if (c == '\n') {
+            _line++;
+            _line_start = _current + 1;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            return;
+        }
+        _current++;
+    }
+}
+
 bool Lexer::is_digit(char c) const {
     return (c >= '0' && c <= '9');
 }
@@ -121,10 +368,6 @@ bool Lexer::is_alpha(char c) const {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
-bool Lexer::is_alphanumeric(char c) const {
-    return is_alpha(c) || is_digit(c);
-}
-
 bool Lexer::is_eof() const {
     return _current >= _buffer_size;
 }
@@ -132,25 +375,23 @@ bool Lexer::is_eof() const {
 char Lexer::advance() {
     if (is_eof())
         return '\0';
-    _column++;
-    return _buffer.at(_current++);
+    return _buffer[_current++];
 }
 
 char Lexer::peek() {
     if (is_eof())
         return 0;
-    return _buffer.at(_current);
+    return _buffer[_current];
 }
 
 char Lexer::peek_next() {
     if (_current + 1 >= _buffer_size || is_eof())
         return 0;
-    return _buffer.at(_current + 1);
+    return _buffer[_current + 1];
 }
 
 Token Lexer::string() {
-    while (peek() != '"' && peek() != '\n' && !is_eof())
-        advance();
+    _current = scan_string(_buffer, _current);
 
     if (peek() == '\n' || is_eof()) {
         error("unterminated string");
@@ -166,8 +407,7 @@ Token Lexer::string() {
 }
 
 Token Lexer::number() {
-    while (is_digit(peek()))
-        advance();
+    _current = scan_digits(_buffer, _current);
 
     if (peek() == '.') {
         if (!is_digit(peek_next())) {
@@ -178,29 +418,18 @@ Token Lexer::number() {
         // consume the '.'
         advance();
 
-        while (is_digit(peek()))
-            advance();
+        _current = scan_digits(_buffer, _current);
     }
 
     return Token(TT_NUMBER, _line, _buffer.substr(_start, _current - _start));
 }
 
 Token Lexer::identifier() {
-    while (peek() == '_' || is_alphanumeric(peek()))
-        advance();
+    _current = scan_identifier(_buffer, _current);
 
-    u32 type = TT_IDENTIFIER;
-
-    std::string name = _buffer.substr(_start, _current - _start);
-
-    for (u32 i = 0; i < TT_RESERVED_COUNT; i++) {
-        if (name == Token::reserved_keywords[i]) {
-            type = i + TT_RESERVED_BEGIN;
-            break;
-        }
-    }
+    std::string_view name = _buffer.substr(_start, _current - _start);
 
-    return Token(static_cast<TokenType>(type), _line, name);
+    return Token(static_cast<TokenType>(keyword_type(name)), _line, name);
 }
 
 } // namespace script
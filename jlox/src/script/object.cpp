@@ -1,7 +1,190 @@
 #include "script/object.hpp"
 
+#include <iterator>
+#include <vector>
+#include <fmt/core.h>
+
 namespace script {
 
-// TODO: remove
+ScriptHeapObject::ScriptHeapObject(u8 type)
+    : type(type),
+      marked(false),
+      remembered(false),
+      size(0) {
+}
+
+void ScriptHeapObject::trace(Heap&) {
+}
+
+ScriptHeapObject* ScriptHeapObject::relocate() {
+    return nullptr;
+}
+
+bool ScriptHeapObject::owns_memory() const {
+    return true;
+}
+
+ScriptString::ScriptString(std::string value)
+    : ScriptHeapObject(ScriptObjectType::String),
+      value(std::move(value)),
+      hash(0),
+      interned(false),
+      flat(true) {
+}
+
+ScriptString::ScriptString()
+    : ScriptHeapObject(ScriptObjectType::String),
+      hash(0),
+      interned(false),
+      flat(false) {
+}
+
+ScriptHeapObject* ScriptString::relocate() {
+    return new ScriptString(std::move(value));
+}
+
+bool ScriptString::owns_memory() const {
+    // short strings are stored inside of the object
+    const char* data = value.data();
+    return data < reinterpret_cast<const char*>(this) || data >= reinterpret_cast<const char*>(this + 1);
+}
+
+std::string ScriptString::to_string() {
+    return str();
+}
+
+void ScriptString::flatten() {
+    auto* rope = static_cast<ScriptRope*>(this);
+
+    std::string text;
+    text.reserve(rope->length);
+
+    // ropes built in a loop lean to the left and can be as deep as the loop ran, so no recursion
+    std::vector<ScriptObject> parts{ rope->right, rope->left };
+    while (!parts.empty()) {
+        ScriptObject part = parts.back();
+        parts.pop_back();
+
+        if (part.is_number()) {
+            fmt::format_to(std::back_inserter(text), "{}", part.as_number());
+            continue;
+        }
+
+        auto* string = part.as<ScriptString>();
+        if (string->flat) {
+            text += string->value;
+        } else {
+            auto* child = static_cast<ScriptRope*>(string);
+            parts.push_back(child->right);
+            parts.push_back(child->left);
+        }
+    }
+
+    value = std::move(text);
+    flat = true;
+    rope->left = ScriptObject();
+    rope->right = ScriptObject();
+
+    Heap& heap = Heap::instance();
+    if (heap.is_young(this) && owns_memory())
+        heap.add_finalizer(this);
+}
+
+static usize part_length(const ScriptObject& part) {
+    if (part.is_number())
+        return fmt::formatted_size("{}", part.as_number());
+
+    auto* string = part.as<ScriptString>();
+    return string->flat ? string->value.size() : static_cast<ScriptRope*>(string)->length;
+}
+
+ScriptRope::ScriptRope(const ScriptObject& left, const ScriptObject& right, usize length)
+    : left(left),
+      right(right),
+      length(length) {
+}
+
+void ScriptRope::trace(Heap& heap) {
+    heap.mark(left);
+    heap.mark(right);
+}
+
+ScriptHeapObject* ScriptRope::relocate() {
+    if (flat)
+        return new ScriptString(std::move(value));
+
+    // the parts may have been moved already, they are only updated once the copy is traced
+    return new ScriptRope(left, right, length);
+}
+
+bool is_true(const ScriptObject& object) {
+    if (object.is_nil())
+        return false;
+    else if (object.is_boolean())
+        return object.as_boolean();
+    return true;
+}
+
+bool is_equal(const ScriptObject& a, const ScriptObject& b) {
+    if (a.is_number() && b.is_number())
+        return a.as_number() == b.as_number();
+
+    u8 type = a.type();
+    if (type != b.type())
+        return false;
+    else if (type == ScriptObjectType::Nil)
+        return true;
+    else if (type == ScriptObjectType::String) {
+        auto* x = a.as<ScriptString>();
+        auto* y = b.as<ScriptString>();
+        if (x == y)
+            return true;
+        if (x->interned && y->interned)
+            return false;
+        return x->str() == y->str();
+    }
+    return false;
+}
+
+std::ostream& operator<<(std::ostream& stream, const ScriptObject& object) {
+    if (object.is_number())
+        stream << object.as_number();
+    else if (object.is_nil())
+        stream << "nil";
+    else if (object.is_boolean())
+        stream << (object.as_boolean() ? "true" : "false");
+    else if (object.is_object_type(ScriptObjectType::String))
+        stream << object.as_string();
+    else
+        stream << object.as_object()->to_string();
+
+    return stream;
+}
+
+ScriptObject concatenate(ScriptObject& left, ScriptObject& right) {
+    usize length = part_length(left) + part_length(right);
+    if (length >= ScriptRope::min_length) {
+        ScriptObject rope = create_object<ScriptRope>(left, right, length);
+
+        // the rope is only allocated old inside of a NoCollection scope, its parts can be young then
+        Heap& heap = Heap::instance();
+        heap.write_barrier(rope.as_object(), left);
+        heap.write_barrier(rope.as_object(), right);
+        return rope;
+    }
+
+    std::string text;
+    if (left.is_number())
+        text = fmt::format("{}", left.as_number());
+    else
+        text = left.as_string();
+
+    if (right.is_number())
+        fmt::format_to(std::back_inserter(text), "{}", right.as_number());
+    else
+        text += right.as_string();
+
+    return create_object<ScriptString>(std::move(text));
+}
 
 } // namespace script
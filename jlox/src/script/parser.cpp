@@ -1,26 +1,42 @@
 #include "script/parser.hpp"
 
+#include "script/string_table.hpp"
 #include "common/exception.hpp"
 
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
 
 namespace script {
 
-Parser::Parser(const std::string& buffer)
+static f64 parse_number(std::string_view text) {
+    f64 value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+
+    // from_chars leaves the value alone for literals out of range, strtod rounds them to infinity or to zero
+    if (error != std::errc())
+        return std::strtod(std::string(text).c_str(), nullptr);
+
+    return value;
+}
+
+Parser::Parser(Box<Source> source)
     : _previous(TT_INVALID),
       _error(false),
-      _allow_break_stmt(false) {
-    _lexer = std::make_unique<Lexer>(buffer);
+      _allow_break_stmt(false),
+      _program(create_box<Program>()) {
+    _program->source = std::move(source);
+    _lexer = std::make_unique<Lexer>(_program->source->text());
     _current = _lexer->next();
 }
 
-std::vector<Node::ptr>& Parser::parse() {
+Box<Program> Parser::parse() {
     while (_current.type != TokenType::TT_EOF) {
         auto stmt = parse_decl();
-        _statements.push_back(std::move(stmt));
+        _program->statements.push_back(std::move(stmt));
     }
 
-    return _statements;
+    return std::move(_program);
 }
 
 bool Parser::error() const {
@@ -30,6 +46,10 @@ bool Parser::error() const {
 Token Parser::advance() {
     _previous = _current;
     _current = _lexer->next();
+
+    if (_previous.type == TokenType::TT_IDENTIFIER)
+        _previous.string = StringTable::instance().intern(_previous.value);
+
     return _previous;
 }
 
@@ -123,7 +143,7 @@ Stmt::ptr Parser::parse_var_decl() {
 
     consume(TokenType::TT_SEMICOLON, "Expect ';' after expression");
 
-    return std::make_unique<VarStmt>(name, std::move(initializer));
+    return make_node<VarStmt>(name, std::move(initializer));
 }
 
 Stmt::ptr Parser::parse_function_decl(const std::string& kind, bool anon_decl, bool var_decl) {
@@ -162,7 +182,7 @@ Stmt::ptr Parser::parse_function_decl(const std::string& kind, bool anon_decl, b
         throw_error(_current, "semicolon is not allowed here");
     }
 
-    return std::make_unique<FunctionStmt>(name, std::move(parameters), std::move(body));
+    return make_node<FunctionStmt>(name, std::move(parameters), std::move(body));
 }
 
 Stmt::ptr Parser::parse_class_decl() {
@@ -176,14 +196,14 @@ Stmt::ptr Parser::parse_class_decl() {
 
     consume(TokenType::TT_RIGHT_BRACE, "Expect '}' after class body");
 
-    return std::make_unique<ClassStmt>(name, std::move(methods));
+    return make_node<ClassStmt>(name, std::move(methods));
 }
 
 Stmt::ptr Parser::parse_stmt() {
     if (match(TokenType::TT_PRINT))
         return parse_print_stmt();
     else if (match(TokenType::TT_LEFT_BRACE))
-        return std::make_unique<BlockStmt>(parse_block());
+        return make_node<BlockStmt>(parse_block());
     else if (match(TokenType::TT_IF))
         return parse_if_stmt();
     else if (match(TokenType::TT_WHILE))
@@ -202,14 +222,14 @@ Stmt::ptr Parser::parse_print_stmt() {
     auto expr = parse_expr();
     consume(TokenType::TT_SEMICOLON, "Expect ';' after expression");
 
-    return std::make_unique<PrintStmt>(std::move(expr));
+    return make_node<PrintStmt>(std::move(expr));
 }
 
 Stmt::ptr Parser::parse_expr_stmt() {
     auto expr = parse_expr();
     consume(TokenType::TT_SEMICOLON, "Expect ';' after expression");
 
-    return std::make_unique<ExprStmt>(std::move(expr));
+    return make_node<ExprStmt>(std::move(expr));
 }
 
 Stmt::ptr Parser::parse_if_stmt() {
@@ -220,7 +240,7 @@ Stmt::ptr Parser::parse_if_stmt() {
     Stmt::ptr then_branch = parse_stmt();
     Stmt::ptr else_branch = match(TokenType::TT_ELSE) ? parse_stmt() : nullptr;
 
-    return std::make_unique<IfStmt>(std::move(condition), std::move(then_branch), std::move(else_branch));
+    return make_node<IfStmt>(std::move(condition), std::move(then_branch), std::move(else_branch));
 }
 
 Stmt::ptr Parser::parse_while_stmt() {
@@ -232,7 +252,7 @@ Stmt::ptr Parser::parse_while_stmt() {
     Stmt::ptr body = parse_stmt();
     _allow_break_stmt = false;
 
-    return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    return make_node<WhileStmt>(std::move(condition), std::move(body));
 }
 
 Stmt::ptr Parser::parse_for_stmt() {
@@ -267,24 +287,24 @@ Stmt::ptr Parser::parse_for_stmt() {
         std::vector<Node::ptr> statements;
         statements.push_back(std::move(body));
         statements.push_back(std::move(increment));
-        body = std::make_unique<BlockStmt>(std::move(statements));
+        body = make_node<BlockStmt>(std::move(statements));
     }
 
     // if the condition was omitted then we emplace a 'true' literal expr
     if (!condition) {
-        condition = std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
+        condition = make_node<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
         LiteralExpr* literal_expr = reinterpret_cast<LiteralExpr*>(condition.get());
         literal_expr->value = true;
     }
 
-    body = std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    body = make_node<WhileStmt>(std::move(condition), std::move(body));
 
     // if we have an initializer node then we can 'prepend' to the body stmt
     if (initializer) {
         std::vector<Node::ptr> statements;
         statements.push_back(std::move(initializer));
         statements.push_back(std::move(body));
-        body = std::make_unique<BlockStmt>(std::move(statements));
+        body = make_node<BlockStmt>(std::move(statements));
     }
 
     return body;
@@ -293,7 +313,7 @@ Stmt::ptr Parser::parse_for_stmt() {
 Stmt::ptr Parser::parse_break_stmt() {
     if (_allow_break_stmt) {
         consume(TokenType::TT_SEMICOLON, "Expect ';' after 'break'");
-        return std::make_unique<BreakStmt>();
+        return make_node<BreakStmt>();
     }
 
     throw_error(_current, "a break statement may only be used within a loop");
@@ -309,7 +329,7 @@ Stmt::ptr Parser::parse_return_stmt() {
     }
 
     consume(TokenType::TT_SEMICOLON, "Expect ';' after return value");
-    return std::make_unique<ReturnStmt>(keyword, std::move(value));
+    return make_node<ReturnStmt>(keyword, std::move(value));
 }
 
 std::vector<Node::ptr> Parser::parse_block() {
@@ -336,10 +356,10 @@ Node::ptr Parser::parse_assignment_expr() {
 
         if (expr->type() == Node::Type::VariableExpr) {
             Token name = reinterpret_cast<VariableExpr*>(expr.get())->name;
-            return std::make_unique<AssignmentExpr>(name, std::move(value));
+            return make_node<AssignmentExpr>(name, std::move(value));
         } else if (expr->type() == Node::Type::GetExpr) {
             GetExpr* get = reinterpret_cast<GetExpr*>(expr.get());
-            return std::make_unique<SetExpr>(std::move(get->object), get->name, std::move(value));
+            return make_node<SetExpr>(std::move(get->object), get->name, std::move(value));
         }
 
         throw_error(equals, "Invalid assignment target");
@@ -356,7 +376,7 @@ Node::ptr Parser::parse_conditional_expr() {
         consume(TokenType::TT_COLON, "Expect ':' after expression.");
         Node::ptr right = parse_expr();
 
-        expr = std::make_unique<ConditionalExpr>(std::move(expr), std::move(left), std::move(right));
+        expr = make_node<ConditionalExpr>(std::move(expr), std::move(left), std::move(right));
     }
 
     return expr;
@@ -369,7 +389,7 @@ Node::ptr Parser::parse_logical_or_expr() {
         Token op = _previous;
         Node::ptr right = parse_logical_and_expr();
 
-        expr = std::make_unique<LogicalExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<LogicalExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -382,7 +402,7 @@ Node::ptr Parser::parse_logical_and_expr() {
         Token op = _previous;
         Node::ptr right = parse_equality_expr();
 
-        expr = std::make_unique<LogicalExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<LogicalExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -395,7 +415,7 @@ Node::ptr Parser::parse_equality_expr() {
         Token op = _previous;
         Node::ptr right = parse_comparison_expr();
 
-        expr = std::make_unique<BinaryExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<BinaryExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -409,7 +429,7 @@ Node::ptr Parser::parse_comparison_expr() {
         Token op = _previous;
         Node::ptr right = parse_term_expr();
 
-        expr = std::make_unique<BinaryExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<BinaryExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -422,7 +442,7 @@ Node::ptr Parser::parse_term_expr() {
         Token op = _previous;
         Node::ptr right = parse_factor_expr();
 
-        expr = std::make_unique<BinaryExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<BinaryExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -435,7 +455,7 @@ Node::ptr Parser::parse_factor_expr() {
         Token op = _previous;
         Node::ptr right = parse_unary_expr();
 
-        expr = std::make_unique<BinaryExpr>(op, std::move(expr), std::move(right));
+        expr = make_node<BinaryExpr>(op, std::move(expr), std::move(right));
     }
 
     return expr;
@@ -446,7 +466,7 @@ Node::ptr Parser::parse_unary_expr() {
         Token op = _previous;
         Node::ptr expr = parse_unary_expr();
 
-        return std::make_unique<UnaryExpr>(op, std::move(expr));
+        return make_node<UnaryExpr>(op, std::move(expr));
     }
 
     return parse_call_expr();
@@ -460,7 +480,7 @@ Node::ptr Parser::parse_call_expr() {
             expr = parse_call_expr_arguments(std::move(expr));
         } else if (match(TokenType::TT_DOT)) {
             Token name = consume(TokenType::TT_IDENTIFIER, "Expect property name after '.'");
-            expr = std::make_unique<GetExpr>(std::move(expr), name);
+            expr = make_node<GetExpr>(std::move(expr), name);
         } else {
             break;
         }
@@ -490,37 +510,37 @@ Node::ptr Parser::parse_call_expr_arguments(Node::ptr callee) {
     }
 
     Token closing_paren = consume(TokenType::TT_RIGHT_PAREN, "Expect ')' after arguments");
-    return std::make_unique<CallExpr>(std::move(callee), closing_paren, std::move(arguments));
+    return make_node<CallExpr>(std::move(callee), closing_paren, std::move(arguments));
 }
 
 Node::ptr Parser::parse_primary_expr() {
     if (match(TokenType::TT_FALSE)) {
-        auto node = std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
+        auto node = make_node<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
         node->value = false;
         return node;
     } else if (match(TokenType::TT_TRUE)) {
-        auto node = std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
+        auto node = make_node<LiteralExpr>(LiteralExpr::LiteralType::Boolean);
         node->value = true;
         return node;
     } else if (match(TokenType::TT_NIL)) {
-        return std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::Nil);
+        return make_node<LiteralExpr>(LiteralExpr::LiteralType::Nil);
     } else if (match(TokenType::TT_NUMBER)) {
-        auto node = std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::Number);
-        node->value = std::stod(_previous.value);
+        auto node = make_node<LiteralExpr>(LiteralExpr::LiteralType::Number);
+        node->value = parse_number(_previous.value);
         return node;
     } else if (match(TokenType::TT_STRING)) {
-        auto node = std::make_unique<LiteralExpr>(LiteralExpr::LiteralType::String);
-        node->value = _previous.value;
+        auto node = make_node<LiteralExpr>(LiteralExpr::LiteralType::String);
+        node->value = StringTable::instance().intern(_previous.value);
         return node;
     } else if (match(TokenType::TT_IDENTIFIER)) {
-        auto node = std::make_unique<VariableExpr>(_previous);
+        auto node = make_node<VariableExpr>(_previous);
         return node;
     }
 
     if (match(TokenType::TT_LEFT_PAREN)) {
         Node::ptr expr = parse_expr();
         consume(TokenType::TT_RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_unique<GroupingExpr>(std::move(expr));
+        return make_node<GroupingExpr>(std::move(expr));
     }
 
     Parser::throw_error(_current, "Expect expression");
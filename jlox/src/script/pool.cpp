@@ -0,0 +1,37 @@
+#include "script/pool.hpp"
+
+#include <new>
+
+namespace script {
+
+void* Pool::allocate(usize size) {
+    if (size == 0 || size > max_block_size)
+        return ::operator new(size);
+
+    usize index = (size - 1) / granularity;
+    if (FreeBlock* block = _free_lists[index]) {
+        _free_lists[index] = block->next;
+        return block;
+    }
+
+    return ::operator new((index + 1) * granularity);
+}
+
+void Pool::deallocate(void* block, usize size) {
+    if (size == 0 || size > max_block_size) {
+        ::operator delete(block);
+        return;
+    }
+
+    usize index = (size - 1) / granularity;
+    auto* free_block = static_cast<FreeBlock*>(block);
+    free_block->next = _free_lists[index];
+    _free_lists[index] = free_block;
+}
+
+Pool& Pool::instance() {
+    static Pool* pool = new Pool();
+    return *pool;
+}
+
+} // namespace script
@@ -1,14 +1,37 @@
 #include "script/resolver.hpp"
 #include "common/exception.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 namespace script {
 
-Resolver::Resolver(Interpreter* interpreter)
+// operators of a binary expression that can't fail once its operands are numbers
+static bool fusable_operator(u32 op) {
+    switch (op) {
+    case TokenType::TT_PLUS:
+    case TokenType::TT_MINUS:
+    case TokenType::TT_STAR:
+    case TokenType::TT_GREATER:
+    case TokenType::TT_GREATER_EQUAL:
+    case TokenType::TT_LESS:
+    case TokenType::TT_LESS_EQUAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool is_local_variable(Node* node) {
+    return node->type() == Node::Type::VariableExpr &&
+           static_cast<VariableExpr*>(node)->location.kind == VariableLocation::Local;
+}
+
+Resolver::Resolver()
     : _error(false),
-      _interpreter(interpreter),
+      _fusion(true),
       _current_scope_type(ScopeType::Global) {
+    _functions.push_back({ nullptr, 0, 0, 0 });
 }
 
 bool Resolver::error() const {
@@ -23,6 +46,10 @@ void Resolver::run(std::vector<Node::ptr>& statements) {
     }
 }
 
+void Resolver::set_fusion(bool enabled) {
+    _fusion = enabled;
+}
+
 void Resolver::visit_print_stmt(PrintStmt* stmt) {
     resolve_expr(reinterpret_cast<Expr*>(stmt->expr.get()));
 }
@@ -32,7 +59,7 @@ void Resolver::visit_expr_stmt(ExprStmt* stmt) {
 }
 
 void Resolver::visit_var_stmt(VarStmt* stmt) {
-    declare(stmt->name);
+    stmt->location = declare(stmt->name);
     if (stmt->initializer) {
         resolve_expr(reinterpret_cast<Expr*>(stmt->initializer.get()));
     }
@@ -40,13 +67,27 @@ void Resolver::visit_var_stmt(VarStmt* stmt) {
 }
 
 void Resolver::visit_block_stmt(BlockStmt* stmt) {
+    // the outermost block at the top level owns the frame of everything declared inside of it
+    bool owns_frame = _scopes.empty();
+    if (owns_frame) {
+        _functions.back().frame_top = 0;
+        _functions.back().frame_size = 0;
+    }
+
+    stmt->first_slot = _functions.back().frame_top;
+
     begin_scope();
     resolve_statements(stmt->statements);
-    end_scope();
+    stmt->closes_upvalues = end_scope();
+
+    if (owns_frame) {
+        stmt->frame_size = _functions.back().frame_size;
+    }
 }
 
 void Resolver::visit_if_stmt(IfStmt* stmt) {
     resolve_expr(reinterpret_cast<Expr*>(stmt->condition.get()));
+    stmt->fusion = condition_fusion(stmt->condition.get());
     resolve_stmt(stmt->then_branch.get());
     if (stmt->else_branch) {
         resolve_stmt(stmt->else_branch.get());
@@ -55,6 +96,7 @@ void Resolver::visit_if_stmt(IfStmt* stmt) {
 
 void Resolver::visit_while_stmt(WhileStmt* stmt) {
     resolve_expr(reinterpret_cast<Expr*>(stmt->condition.get()));
+    stmt->fusion = condition_fusion(stmt->condition.get());
     resolve_stmt(reinterpret_cast<Stmt*>(stmt->body.get()));
 }
 
@@ -62,10 +104,13 @@ void Resolver::visit_break_stmt(BreakStmt* stmt) {
     (void)stmt;
 }
 
-// TODO: make sure this works with anonymous functions too
 void Resolver::visit_function_stmt(FunctionStmt* stmt) {
-    declare(stmt->name);
-    define(stmt->name);
+    // anonymous functions are expressions and do not declare a name
+    if (stmt->name.type != TokenType::TT_INVALID) {
+        stmt->location = declare(stmt->name);
+        define(stmt->name);
+    }
+
     resolve_function(stmt, ScopeType::Function);
 }
 
@@ -80,7 +125,7 @@ void Resolver::visit_return_stmt(ReturnStmt* stmt) {
 }
 
 void Resolver::visit_class_stmt(ClassStmt* stmt) {
-    declare(stmt->name);
+    stmt->location = declare(stmt->name);
     define(stmt->name);
 }
 
@@ -91,6 +136,18 @@ void Resolver::visit_unary_expr(UnaryExpr* node) {
 void Resolver::visit_binary_expr(BinaryExpr* node) {
     resolve_expr(reinterpret_cast<Expr*>(node->left.get()));
     resolve_expr(reinterpret_cast<Expr*>(node->right.get()));
+
+    if (!_fusion || !fusable_operator(node->op.type) || !is_local_variable(node->left.get()) ||
+        node->right->type() != Node::Type::LiteralExpr)
+        return;
+
+    auto* literal = static_cast<LiteralExpr*>(node->right.get());
+    if (literal->literal_type != LiteralExpr::LiteralType::Number)
+        return;
+
+    node->fusion = Fusion::LocalNumber;
+    node->slot = static_cast<VariableExpr*>(node->left.get())->location.slot;
+    node->number = std::get<f64>(literal->value);
 }
 
 void Resolver::visit_grouping_expr(GroupingExpr* node) {
@@ -115,21 +172,29 @@ void Resolver::visit_conditional_expr(ConditionalExpr* node) {
 void Resolver::visit_variable_expr(VariableExpr* node) {
     // check if the variable exists in the current scope and ensure the entry is defined (false means declared)
     if (!_scopes.empty()) {
-        auto& scope = _scopes.back();
+        auto& scope = _scopes.back().variables;
         if (scope.contains(node->name.value)) {
-            auto& variable_state = scope[node->name.value];
-            if (variable_state == VariableState::Declared) {
+            auto& variable = scope[node->name.value];
+            if (variable.state == VariableState::Declared) {
                 throw_error(node->name, "Can't read variable in it's own initializer");
             }
         }
     }
 
-    resolve_local(node, node->name);
+    resolve_local(node->location, node->name);
 }
 
 void Resolver::visit_assignment_expr(AssignmentExpr* node) {
     resolve_expr(reinterpret_cast<Expr*>(node->value.get()));
-    resolve_local(node, node->name);
+    resolve_local(node->location, node->name);
+
+    if (node->location.kind != VariableLocation::Local || node->value->type() != Node::Type::BinaryExpr)
+        return;
+
+    auto* value = static_cast<BinaryExpr*>(node->value.get());
+    if (value->fusion == Fusion::LocalNumber && value->op.type == TokenType::TT_PLUS &&
+        value->slot == node->location.slot)
+        node->fusion = Fusion::LocalIncrement;
 }
 
 void Resolver::visit_call_expr(CallExpr* node) {
@@ -146,6 +211,11 @@ void Resolver::visit_call_expr(CallExpr* node) {
 
 void Resolver::visit_get_expr(GetExpr* node) {
     resolve_expr(reinterpret_cast<Expr*>(node->object.get()));
+
+    if (_fusion && is_local_variable(node->object.get())) {
+        node->fusion = Fusion::LocalProperty;
+        node->slot = static_cast<VariableExpr*>(node->object.get())->location.slot;
+    }
 }
 
 void Resolver::visit_set_expr(SetExpr* node) {
@@ -179,10 +249,10 @@ void Resolver::resolve_statements(std::vector<Node::ptr>& statements) {
     }
 }
 
-// TODO: make sure this works with anonymous functions too
 void Resolver::resolve_function(FunctionStmt* stmt, ScopeType scope_type) {
     ScopeType enclosing_scope_type = _current_scope_type;
     _current_scope_type = scope_type;
+    _functions.push_back({ stmt, _scopes.size(), 0, 0 });
 
     begin_scope();
 
@@ -193,39 +263,62 @@ void Resolver::resolve_function(FunctionStmt* stmt, ScopeType scope_type) {
 
     resolve_statements(stmt->body);
 
+    // variables of the function scope are closed when the call returns
     end_scope();
 
+    stmt->frame_size = _functions.back().frame_size;
+    _functions.pop_back();
+
     _current_scope_type = enclosing_scope_type;
 }
 
 void Resolver::begin_scope() {
-    std::unordered_map<std::string, VariableState> new_scope;
-    _scopes.push_back(new_scope);
+    _scopes.push_back({ {}, _functions.back().frame_top });
 }
 
-void Resolver::end_scope() {
+bool Resolver::end_scope() {
     auto& scope = _scopes.back();
-    for (auto& [name, state] : scope) {
-        if (state != VariableState::Used) {
+
+    bool captured = false;
+    for (auto& [name, variable] : scope.variables) {
+        if (variable.state != VariableState::Used) {
             std::cerr << "[resolver warning]: unused variable '" << name << "'\n";
         }
+        captured |= variable.captured;
     }
 
+    // slots of the scope are reused by the next one
+    _functions.back().frame_top = scope.first_slot;
     _scopes.pop_back();
+
+    return captured;
 }
 
-void Resolver::declare(Token& name) {
+VariableLocation Resolver::declare(Token& name) {
+    VariableLocation location;
     if (_scopes.empty()) {
-        return;
+        return location;
     }
 
     auto& scope = _scopes.back();
+    auto& function = _functions.back();
 
-    if (scope.contains(name.value)) {
+    if (scope.variables.contains(name.value)) {
         throw_error(name, "Already a variable with this name in current scope");
     }
 
-    scope[name.value] = VariableState::Declared;
+    // the vm addresses slots with a byte and keeps the called function in its first one
+    if (function.frame_top >= UINT8_MAX) {
+        throw_error(name, "Too many local variables in function");
+    }
+
+    location.kind = VariableLocation::Local;
+    location.slot = static_cast<u16>(function.frame_top++);
+    function.frame_size = std::max(function.frame_size, function.frame_top);
+
+    scope.variables[name.value] = { VariableState::Declared, location.slot, false };
+
+    return location;
 }
 
 void Resolver::define(Token& name) {
@@ -234,19 +327,84 @@ void Resolver::define(Token& name) {
     }
 
     auto& scope = _scopes.back();
-    scope[name.value] = VariableState::Defined;
+    scope.variables[name.value].state = VariableState::Defined;
 }
 
-void Resolver::resolve_local(Expr* expr, Token& name) {
-    usize depth = _scopes.size() - 1;
-    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); scope++) {
-        if (scope->contains(name.value)) {
-            scope->at(name.value) = VariableState::Used;
-            _interpreter->resolve(expr, _scopes.size() - 1 - depth);
-            return;
+void Resolver::resolve_local(VariableLocation& location, Token& name) {
+    location = VariableLocation();
+
+    usize function = _functions.size() - 1;
+
+    i32 slot = find_local(function, name.value);
+    if (slot != -1) {
+        location.kind = VariableLocation::Local;
+        location.slot = static_cast<u16>(slot);
+        return;
+    }
+
+    i32 upvalue = find_upvalue(function, name.value);
+    if (upvalue != -1) {
+        location.kind = VariableLocation::Upvalue;
+        location.slot = static_cast<u16>(upvalue);
+    }
+}
+
+i32 Resolver::find_local(usize function, std::string_view name) {
+    usize first_scope = _functions[function].first_scope;
+    usize end_scope = function + 1 < _functions.size() ? _functions[function + 1].first_scope : _scopes.size();
+
+    for (usize i = end_scope; i > first_scope; i--) {
+        auto& scope = _scopes[i - 1];
+        auto itr = scope.variables.find(name);
+        if (itr != scope.variables.end()) {
+            itr->second.state = VariableState::Used;
+            // an inner function is the one looking, the variable escapes into its closure
+            if (function + 1 < _functions.size()) {
+                itr->second.captured = true;
+            }
+            return itr->second.slot;
         }
-        depth--;
     }
+
+    return -1;
+}
+
+i32 Resolver::find_upvalue(usize function, std::string_view name) {
+    if (function == 0)
+        return -1;
+
+    i32 local = find_local(function - 1, name);
+    if (local != -1)
+        return add_upvalue(function, static_cast<u16>(local), true);
+
+    i32 upvalue = find_upvalue(function - 1, name);
+    if (upvalue != -1)
+        return add_upvalue(function, static_cast<u16>(upvalue), false);
+
+    return -1;
+}
+
+Fusion Resolver::condition_fusion(Node* condition) {
+    if (condition->type() != Node::Type::BinaryExpr)
+        return Fusion::None;
+
+    return static_cast<BinaryExpr*>(condition)->fusion;
+}
+
+i32 Resolver::add_upvalue(usize function, u16 index, bool is_local) {
+    auto& upvalues = _functions[function].function->upvalues;
+    for (usize i = 0; i < upvalues.size(); i++) {
+        if (upvalues[i].index == index && upvalues[i].is_local == is_local)
+            return static_cast<i32>(i);
+    }
+
+    if (upvalues.size() > UINT8_MAX) {
+        _error = true;
+        throw ResolverError("Too many closure variables in function");
+    }
+
+    upvalues.push_back({ index, is_local });
+    return static_cast<i32>(upvalues.size() - 1);
 }
 
 } // namespace script
@@ -0,0 +1,34 @@
+#include "script/shape.hpp"
+
+namespace script {
+
+Shape* Shape::empty() {
+    static Shape* shape = new Shape();
+    return shape;
+}
+
+Shape* Shape::add_field(ScriptString* name) {
+    auto itr = _transitions.find(name);
+    if (itr != _transitions.end())
+        return itr->second.get();
+
+    Box<Shape> child(new Shape());
+    child->_slots = _slots;
+    child->_slots.emplace(name, field_count());
+
+    return _transitions.emplace(name, std::move(child)).first->second.get();
+}
+
+i32 Shape::find_field(ScriptString* name) const {
+    auto itr = _slots.find(name);
+    if (itr == _slots.end())
+        return -1;
+
+    return static_cast<i32>(itr->second);
+}
+
+u32 Shape::field_count() const {
+    return static_cast<u32>(_slots.size());
+}
+
+} // namespace script
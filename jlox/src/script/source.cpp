@@ -0,0 +1,65 @@
+#include "script/source.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace script {
+
+Source::Source(std::string text)
+    : _buffer(std::move(text)) {
+}
+
+Source::~Source() {
+    if (_mapping)
+        munmap(_mapping, _mapping_size);
+}
+
+Box<Source> Source::from_file(const char* path) {
+    i32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    Box<Source> source(new Source());
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            source->_mapping = mapping;
+            source->_mapping_size = info.st_size;
+            close(fd);
+            return source;
+        }
+    }
+
+    // Pipes, fifos and /dev/stdin have no size up front and can't be mapped, read them until EOF instead.
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count == 0)
+            break;
+        if (count < 0) {
+            close(fd);
+            return nullptr;
+        }
+        source->_buffer.append(chunk, count);
+    }
+
+    close(fd);
+    return source;
+}
+
+std::string_view Source::text() const {
+    if (_mapping)
+        return std::string_view(static_cast<const char*>(_mapping), _mapping_size);
+    return _buffer;
+}
+
+bool Source::mapped() const {
+    return _mapping != nullptr;
+}
+
+} // namespace script
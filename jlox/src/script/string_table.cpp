@@ -0,0 +1,72 @@
+#include "script/string_table.hpp"
+
+#include <cstring>
+
+namespace script {
+
+// FNV-1a, identifiers are short and the table compares the hash before the characters
+static u32 hash_string(std::string_view value) {
+    u32 hash = 2166136261u;
+    for (char c : value) {
+        hash ^= static_cast<u8>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+StringTable& StringTable::instance() {
+    static StringTable* table = new StringTable();
+    return *table;
+}
+
+StringTable::StringTable()
+    : _slots(initial_capacity, nullptr) {
+}
+
+ScriptString* StringTable::intern(std::string_view value) {
+    u32 hash = hash_string(value);
+    usize mask = _slots.size() - 1;
+
+    usize index = hash & mask;
+    while (ScriptString* string = _slots[index]) {
+        if (string->hash == hash && string->value.size() == value.size() &&
+            std::memcmp(string->value.data(), value.data(), value.size()) == 0)
+            return string;
+        index = (index + 1) & mask;
+    }
+
+    // not tracked by the heap, a string that is already marked is never visited
+    auto* string = new ScriptString(std::string(value));
+    string->hash = hash;
+    string->interned = true;
+    string->marked = true;
+
+    _slots[index] = string;
+    if (++_size * 2 > _slots.size())
+        grow();
+
+    return string;
+}
+
+usize StringTable::size() const {
+    return _size;
+}
+
+void StringTable::grow() {
+    std::vector<ScriptString*> slots(_slots.size() * 2, nullptr);
+    usize mask = slots.size() - 1;
+
+    for (auto* string : _slots) {
+        if (!string)
+            continue;
+
+        usize index = string->hash & mask;
+        while (slots[index])
+            index = (index + 1) & mask;
+        slots[index] = string;
+    }
+
+    _slots = std::move(slots);
+}
+
+} // namespace script
@@ -12,23 +12,27 @@ const char* Token::reserved_keywords[] = {
 
 Token::Token()
     : type(TokenType::TT_INVALID),
-      line(0) {
+      line(0),
+      string(nullptr) {
 }
 
 Token::Token(TokenType type)
     : type(type),
-      line(0) {
+      line(0),
+      string(nullptr) {
 }
 
 Token::Token(TokenType type, u32 line)
     : type(type),
-      line(line) {
+      line(line),
+      string(nullptr) {
 }
 
-Token::Token(TokenType type, u32 line, const std::string& value)
+Token::Token(TokenType type, u32 line, std::string_view value)
     : type(type),
       line(line),
-      value(value) {
+      value(value),
+      string(nullptr) {
 }
 
 std::string Token::to_string() {
@@ -76,9 +80,8 @@ std::string Token::to_string() {
     case TokenType::TT_LESS_EQUAL:
         return "<=";
     case TokenType::TT_IDENTIFIER:
-        return value;
     case TokenType::TT_STRING:
-        return value;
+        return std::string(value);
     case TokenType::TT_NUMBER:
         return fmt::format("{}", value);
     case TokenType::TT_EOF:
@@ -0,0 +1,704 @@
+#include "script/vm.hpp"
+
+#include "script/class.hpp"
+#include "script/class_instance.hpp"
+
+#include "common/exception.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <fmt/core.h>
+
+namespace script {
+
+VM::VM()
+    : _frame_count(0),
+      _quickening(true) {
+    _frames = std::make_unique<CallFrame[]>(frames_max);
+    _stack = std::make_unique<ScriptObject[]>(stack_max);
+    _stack_top = _stack.get();
+    _stack_end = _stack.get() + stack_max;
+
+    Heap::instance().add_roots(this);
+}
+
+VM::~VM() {
+    Heap::instance().remove_roots(this);
+}
+
+void VM::interpret(Arc<FunctionProto> function) {
+    ScriptObject callee = create_object<ScriptClosure>(function);
+
+    try {
+        push(callee);
+        call(callee.as<ScriptClosure>(), 0);
+        run();
+    } catch (const RuntimeError& e) {
+        std::cerr << "[runtime error]: " << e.what() << "\n";
+        reset_stack();
+    }
+}
+
+u16 VM::global_slot(ScriptString* name) {
+    auto itr = _global_slots.find(name);
+    if (itr != _global_slots.end())
+        return itr->second;
+
+    u16 slot = static_cast<u16>(_globals.size());
+    _global_slots.emplace(name, slot);
+    _global_names.push_back(name);
+    _globals.emplace_back();
+    _globals_defined.push_back(false);
+
+    return slot;
+}
+
+void VM::add_function(Arc<FunctionProto> function) {
+    _functions.push_back(std::move(function));
+}
+
+void VM::set_quickening(bool enabled) {
+    _quickening = enabled;
+}
+
+void VM::print_quickening_stats() {
+    std::cout << "-------- QUICKENING STATS --------\n";
+    for (auto& function : _functions) {
+        function->chunk.print_quickening_stats(function->name);
+    }
+    std::cout << "----------------------------------\n";
+}
+
+void VM::mark_roots(Heap& heap) {
+    for (ScriptObject* slot = _stack.get(); slot != _stack_top; slot++) {
+        heap.mark(*slot);
+    }
+
+    for (usize i = 0; i < _frame_count; i++) {
+        heap.mark(_frames[i].closure);
+    }
+
+    for (auto& global : _globals) {
+        heap.mark(global);
+    }
+
+    // constants are allocated old and never reference anything young
+    if (heap.collecting_young())
+        return;
+
+    for (auto& function : _functions) {
+        function->trace(heap);
+    }
+}
+
+void VM::run() {
+    CallFrame* frame = &_frames[_frame_count - 1];
+
+    auto read_byte = [&]() {
+        return *frame->ip++;
+    };
+
+    auto read_u16 = [&]() {
+        frame->ip += 2;
+        return static_cast<u16>((frame->ip[-2] << 8) | frame->ip[-1]);
+    };
+
+    auto read_constant = [&]() -> ScriptObject& {
+        return frame->closure->proto->chunk.constants[read_u16()];
+    };
+
+    auto number_operands = [&]() {
+        if (!peek(0).is_number() || !peek(1).is_number())
+            runtime_error("variable type mismatch");
+    };
+
+    auto read_rk = [&]() -> ScriptObject& {
+        u8 operand = read_byte();
+        if (operand & rk_constant)
+            return frame->closure->proto->chunk.constants[operand & ~rk_constant];
+        return frame->slots[operand];
+    };
+
+    auto read_numbers = [&](f64& a, f64& b) {
+        ScriptObject& left = read_rk();
+        ScriptObject& right = read_rk();
+        if (!left.is_number() || !right.is_number())
+            runtime_error("variable type mismatch");
+
+        a = left.as_number();
+        b = right.as_number();
+    };
+
+    // the operands have to be rooted, a string result is allocated
+    auto add = [&](ScriptObject& left, ScriptObject& right) {
+        if (left.is_number() && right.is_number())
+            return ScriptObject(left.as_number() + right.as_number());
+
+        if (!left.is_number() && !left.is_object_type(ScriptObjectType::String))
+            runtime_error("only numbers and strings are allowed for binary expressions");
+        if (!right.is_number() && !right.is_object_type(ScriptObjectType::String))
+            runtime_error("variable type mismatch");
+        return concatenate(left, right);
+    };
+
+    auto divide = [&](f64 a, f64 b) {
+        if (a == 0.0 || b == 0.0)
+            runtime_error("division by zero is not allowed");
+        return a / b;
+    };
+
+    // `site` points at the opcode of an adaptive instruction, its deopt count follows the three operands
+    auto quicken = [&](u8* site, OpCode quickened) {
+        if (_quickening && site[4] < max_deopts)
+            site[0] = quickened;
+    };
+
+    // the generic instruction runs again from the start
+    auto deoptimize = [&](u8* site, OpCode generic) {
+        site[0] = generic;
+        site[4]++;
+        frame->ip = site;
+    };
+
+    // the result of a register instruction is the topmost temporary
+    auto set_temporary = [&](u8 result, const ScriptObject& value) {
+        frame->slots[result] = value;
+        _stack_top = frame->slots + result + 1;
+    };
+
+#ifdef JLOX_COMPUTED_GOTO
+    // in the order of OpCode
+    static void* const dispatch_table[] = {
+        &&label_OP_CONSTANT,
+        &&label_OP_NIL,
+        &&label_OP_TRUE,
+        &&label_OP_FALSE,
+        &&label_OP_POP,
+        &&label_OP_GET_LOCAL,
+        &&label_OP_SET_LOCAL,
+        &&label_OP_GET_GLOBAL,
+        &&label_OP_DEFINE_GLOBAL,
+        &&label_OP_SET_GLOBAL,
+        &&label_OP_GET_UPVALUE,
+        &&label_OP_SET_UPVALUE,
+        &&label_OP_GET_PROPERTY,
+        &&label_OP_SET_PROPERTY,
+        &&label_OP_EQUAL,
+        &&label_OP_NOT_EQUAL,
+        &&label_OP_GREATER,
+        &&label_OP_GREATER_EQUAL,
+        &&label_OP_LESS,
+        &&label_OP_LESS_EQUAL,
+        &&label_OP_ADD,
+        &&label_OP_SUBTRACT,
+        &&label_OP_MULTIPLY,
+        &&label_OP_DIVIDE,
+        &&label_OP_NOT,
+        &&label_OP_NEGATE,
+        &&label_OP_PRINT,
+        &&label_OP_JUMP,
+        &&label_OP_JUMP_IF_FALSE,
+        &&label_OP_JUMP_IF_TRUE,
+        &&label_OP_LOOP,
+        &&label_OP_CALL,
+        &&label_OP_CLOSURE,
+        &&label_OP_CLOSE_UPVALUE,
+        &&label_OP_RETURN,
+        &&label_OP_CLASS,
+        &&label_OP_ADD_RK,
+        &&label_OP_SUBTRACT_RK,
+        &&label_OP_MULTIPLY_RK,
+        &&label_OP_DIVIDE_RK,
+        &&label_OP_EQUAL_RK,
+        &&label_OP_NOT_EQUAL_RK,
+        &&label_OP_GREATER_RK,
+        &&label_OP_GREATER_EQUAL_RK,
+        &&label_OP_LESS_RK,
+        &&label_OP_LESS_EQUAL_RK,
+        &&label_OP_ADD_RK_STORE,
+        &&label_OP_SUBTRACT_RK_STORE,
+        &&label_OP_MULTIPLY_RK_STORE,
+        &&label_OP_DIVIDE_RK_STORE,
+        &&label_OP_ADD_NUM_RK,
+        &&label_OP_EQUAL_NUM_RK,
+        &&label_OP_NOT_EQUAL_NUM_RK,
+        &&label_OP_ADD_NUM_RK_STORE,
+        &&label_OP_TEST_GREATER,
+        &&label_OP_TEST_GREATER_EQUAL,
+        &&label_OP_TEST_LESS,
+        &&label_OP_TEST_LESS_EQUAL,
+        &&label_OP_GET_LOCAL_PROPERTY,
+    };
+    static_assert(std::size(dispatch_table) == OP_COUNT, "every opcode needs a handler");
+
+    // Every handler ends with its own indirect jump to the next one instead of going back to a shared switch, that
+    // gives the branch predictor one jump per opcode to learn from.
+#define CASE(op) label_##op:
+#define NEXT() goto* dispatch_table[instruction = read_byte()]
+
+    u8 instruction;
+    NEXT();
+#else
+#define CASE(op) case op:
+#define NEXT() break
+
+    while (true) {
+        u8 instruction = read_byte();
+
+        switch (instruction) {
+#endif
+        CASE(OP_CONSTANT)
+            push(read_constant());
+            NEXT();
+        CASE(OP_NIL)
+            push(ScriptObject());
+            NEXT();
+        CASE(OP_TRUE)
+            push(ScriptObject(true));
+            NEXT();
+        CASE(OP_FALSE)
+            push(ScriptObject(false));
+            NEXT();
+        CASE(OP_POP)
+            pop();
+            NEXT();
+        CASE(OP_GET_LOCAL)
+            push(frame->slots[read_byte()]);
+            NEXT();
+        CASE(OP_SET_LOCAL)
+            frame->slots[read_byte()] = peek(0);
+            NEXT();
+        CASE(OP_GET_GLOBAL) {
+            u16 slot = read_u16();
+            if (!_globals_defined[slot])
+                runtime_error("Undefined variable '" + _global_names[slot]->value + "'.");
+            push(_globals[slot]);
+        } NEXT();
+        CASE(OP_DEFINE_GLOBAL) {
+            u16 slot = read_u16();
+            _globals[slot] = pop();
+            _globals_defined[slot] = true;
+        } NEXT();
+        CASE(OP_SET_GLOBAL) {
+            u16 slot = read_u16();
+            if (!_globals_defined[slot])
+                runtime_error("Undefined variable '" + _global_names[slot]->value + "'.");
+            _globals[slot] = peek(0);
+        } NEXT();
+        CASE(OP_GET_UPVALUE)
+            push(*frame->closure->upvalues[read_byte()]->location);
+            NEXT();
+        CASE(OP_SET_UPVALUE) {
+            auto& upvalue = frame->closure->upvalues[read_byte()];
+            *upvalue->location = peek(0);
+            Heap::instance().write_barrier(upvalue);
+        } NEXT();
+        CASE(OP_GET_PROPERTY) {
+            auto* name = read_constant().as<ScriptString>();
+            if (!peek(0).is_object_type(ScriptObjectType::ClassInstance))
+                runtime_error("Only class instances have properties");
+
+            auto* field = peek(0).as<ScriptClassInstance>()->find_field(name);
+            if (!field)
+                runtime_error("Undefined property '" + name->value + "'");
+
+            peek(0) = *field;
+        } NEXT();
+        CASE(OP_SET_PROPERTY) {
+            auto* name = read_constant().as<ScriptString>();
+            if (!peek(1).is_object_type(ScriptObjectType::ClassInstance))
+                runtime_error("Only class instances have fields");
+
+            ScriptObject value = pop();
+            auto* instance = peek(0).as<ScriptClassInstance>();
+            instance->set(name, value);
+            Heap::instance().write_barrier(instance, value);
+            peek(0) = std::move(value);
+        } NEXT();
+        CASE(OP_EQUAL)
+        CASE(OP_NOT_EQUAL) {
+            ScriptObject b = pop();
+            peek(0) = ScriptObject(is_equal(peek(0), b) == (instruction == OP_EQUAL));
+        } NEXT();
+        CASE(OP_GREATER)
+        CASE(OP_GREATER_EQUAL)
+        CASE(OP_LESS)
+        CASE(OP_LESS_EQUAL) {
+            number_operands();
+            f64 b = pop().as_number();
+            f64 a = peek(0).as_number();
+
+            if (instruction == OP_GREATER)
+                peek(0) = ScriptObject(a > b);
+            else if (instruction == OP_GREATER_EQUAL)
+                peek(0) = ScriptObject(a >= b);
+            else if (instruction == OP_LESS)
+                peek(0) = ScriptObject(a < b);
+            else
+                peek(0) = ScriptObject(a <= b);
+        } NEXT();
+        CASE(OP_ADD) {
+            // both operands stay on the stack until the result is allocated
+            peek(1) = add(peek(1), peek(0));
+            pop();
+        } NEXT();
+        CASE(OP_SUBTRACT)
+        CASE(OP_MULTIPLY)
+        CASE(OP_DIVIDE) {
+            number_operands();
+            f64 b = pop().as_number();
+            f64 a = peek(0).as_number();
+
+            if (instruction == OP_SUBTRACT) {
+                peek(0) = ScriptObject(a - b);
+            } else if (instruction == OP_MULTIPLY) {
+                peek(0) = ScriptObject(a * b);
+            } else {
+                peek(0) = ScriptObject(divide(a, b));
+            }
+        } NEXT();
+        CASE(OP_NOT)
+            peek(0) = ScriptObject(!is_true(peek(0)));
+            NEXT();
+        CASE(OP_NEGATE)
+            if (!peek(0).is_number())
+                runtime_error("variable type mismatch");
+            peek(0) = ScriptObject(-peek(0).as_number());
+            NEXT();
+        CASE(OP_PRINT)
+            std::cout << "[runtime]: " << pop() << "\n";
+            NEXT();
+        CASE(OP_JUMP) {
+            u16 offset = read_u16();
+            frame->ip += offset;
+        } NEXT();
+        CASE(OP_JUMP_IF_FALSE) {
+            u16 offset = read_u16();
+            if (!is_true(peek(0)))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_JUMP_IF_TRUE) {
+            u16 offset = read_u16();
+            if (is_true(peek(0)))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_LOOP) {
+            u16 offset = read_u16();
+            frame->ip -= offset;
+        } NEXT();
+        CASE(OP_CALL) {
+            u8 arg_count = read_byte();
+            call_value(peek(arg_count), arg_count);
+            frame = &_frames[_frame_count - 1];
+        } NEXT();
+        CASE(OP_CLOSURE) {
+            auto& proto = frame->closure->proto->chunk.functions[read_u16()];
+            ScriptObject object = create_object<ScriptClosure>(proto);
+            auto* closure = object.as<ScriptClosure>();
+
+            for (auto& upvalue : closure->upvalues) {
+                u8 is_local = read_byte();
+                u8 index = read_byte();
+                if (is_local)
+                    upvalue = _open_upvalues.capture(frame->slots + index);
+                else
+                    upvalue = frame->closure->upvalues[index];
+            }
+
+            push(object);
+        } NEXT();
+        CASE(OP_CLOSE_UPVALUE)
+            _open_upvalues.close(_stack_top - 1);
+            pop();
+            NEXT();
+        CASE(OP_RETURN) {
+            ScriptObject result = pop();
+            _open_upvalues.close(frame->slots);
+
+            _frame_count--;
+            if (_frame_count == 0) {
+                pop();
+                return;
+            }
+
+            _stack_top = frame->slots;
+            push(result);
+
+            frame = &_frames[_frame_count - 1];
+        } NEXT();
+        CASE(OP_CLASS)
+            push(create_object<ScriptClass>(read_constant().as_string()));
+            NEXT();
+        CASE(OP_ADD_RK) {
+            u8* site = frame->ip - 1;
+            u8 result = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            frame->ip++;
+
+            if (left.is_number() && right.is_number())
+                quicken(site, OP_ADD_NUM_RK);
+            set_temporary(result, add(left, right));
+        } NEXT();
+        CASE(OP_SUBTRACT_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a - b));
+        } NEXT();
+        CASE(OP_MULTIPLY_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a * b));
+        } NEXT();
+        CASE(OP_DIVIDE_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(divide(a, b)));
+        } NEXT();
+        CASE(OP_EQUAL_RK)
+        CASE(OP_NOT_EQUAL_RK) {
+            u8* site = frame->ip - 1;
+            u8 result = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            frame->ip++;
+
+            if (left.is_number() && right.is_number())
+                quicken(site, instruction == OP_EQUAL_RK ? OP_EQUAL_NUM_RK : OP_NOT_EQUAL_NUM_RK);
+            set_temporary(result, ScriptObject(is_equal(left, right) == (instruction == OP_EQUAL_RK)));
+        } NEXT();
+        CASE(OP_GREATER_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a > b));
+        } NEXT();
+        CASE(OP_GREATER_EQUAL_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a >= b));
+        } NEXT();
+        CASE(OP_LESS_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a < b));
+        } NEXT();
+        CASE(OP_LESS_EQUAL_RK) {
+            u8 result = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            set_temporary(result, ScriptObject(a <= b));
+        } NEXT();
+        CASE(OP_ADD_RK_STORE) {
+            u8* site = frame->ip - 1;
+            u8 local = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            frame->ip++;
+
+            if (left.is_number() && right.is_number())
+                quicken(site, OP_ADD_NUM_RK_STORE);
+            frame->slots[local] = add(left, right);
+        } NEXT();
+        CASE(OP_SUBTRACT_RK_STORE) {
+            u8 local = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            frame->slots[local] = ScriptObject(a - b);
+        } NEXT();
+        CASE(OP_MULTIPLY_RK_STORE) {
+            u8 local = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            frame->slots[local] = ScriptObject(a * b);
+        } NEXT();
+        CASE(OP_DIVIDE_RK_STORE) {
+            u8 local = read_byte();
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            frame->slots[local] = ScriptObject(divide(a, b));
+        } NEXT();
+        CASE(OP_ADD_NUM_RK) {
+            u8* site = frame->ip - 1;
+            u8 result = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            if (!left.is_number() || !right.is_number()) {
+                deoptimize(site, OP_ADD_RK);
+                NEXT();
+            }
+
+            frame->ip++;
+            set_temporary(result, ScriptObject(left.as_number() + right.as_number()));
+        } NEXT();
+        CASE(OP_EQUAL_NUM_RK)
+        CASE(OP_NOT_EQUAL_NUM_RK) {
+            u8* site = frame->ip - 1;
+            u8 result = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            if (!left.is_number() || !right.is_number()) {
+                deoptimize(site, instruction == OP_EQUAL_NUM_RK ? OP_EQUAL_RK : OP_NOT_EQUAL_RK);
+                NEXT();
+            }
+
+            frame->ip++;
+            bool equal = left.as_number() == right.as_number();
+            set_temporary(result, ScriptObject(equal == (instruction == OP_EQUAL_NUM_RK)));
+        } NEXT();
+        CASE(OP_ADD_NUM_RK_STORE) {
+            u8* site = frame->ip - 1;
+            u8 local = read_byte();
+            ScriptObject& left = read_rk();
+            ScriptObject& right = read_rk();
+            if (!left.is_number() || !right.is_number()) {
+                deoptimize(site, OP_ADD_RK_STORE);
+                NEXT();
+            }
+
+            frame->ip++;
+            frame->slots[local] = ScriptObject(left.as_number() + right.as_number());
+        } NEXT();
+        CASE(OP_TEST_GREATER) {
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            u16 offset = read_u16();
+            if (!(a > b))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_TEST_GREATER_EQUAL) {
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            u16 offset = read_u16();
+            if (!(a >= b))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_TEST_LESS) {
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            u16 offset = read_u16();
+            if (!(a < b))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_TEST_LESS_EQUAL) {
+            f64 a;
+            f64 b;
+            read_numbers(a, b);
+            u16 offset = read_u16();
+            if (!(a <= b))
+                frame->ip += offset;
+        } NEXT();
+        CASE(OP_GET_LOCAL_PROPERTY) {
+            ScriptObject& object = frame->slots[read_byte()];
+            auto* name = read_constant().as<ScriptString>();
+            if (!object.is_object_type(ScriptObjectType::ClassInstance))
+                runtime_error("Only class instances have properties");
+
+            auto* field = object.as<ScriptClassInstance>()->find_field(name);
+            if (!field)
+                runtime_error("Undefined property '" + name->value + "'");
+
+            push(*field);
+        } NEXT();
+#ifndef JLOX_COMPUTED_GOTO
+        default:
+            runtime_error(fmt::format("unknown opcode {}", instruction));
+        }
+    }
+#endif
+
+#undef CASE
+#undef NEXT
+}
+
+void VM::reset_stack() {
+    // closures that escaped the frames being dropped keep their variables
+    _open_upvalues.close(_stack.get());
+    _stack_top = _stack.get();
+    _frame_count = 0;
+}
+
+void VM::push(const ScriptObject& value) {
+    if (_stack_top == _stack_end) [[unlikely]]
+        runtime_error("Stack overflow");
+
+    *_stack_top = value;
+    _stack_top++;
+}
+
+ScriptObject VM::pop() {
+    _stack_top--;
+    return *_stack_top;
+}
+
+ScriptObject& VM::peek(usize distance) {
+    return *(_stack_top - 1 - distance);
+}
+
+void VM::call_value(ScriptObject& callee, u8 arg_count) {
+    if (!callee.is_object_type(ScriptObjectType::Callable) && !callee.is_object_type(ScriptObjectType::Class)) {
+        runtime_error("Can only call functions and classes");
+    }
+
+    auto* callable = callee.as<ScriptCallable>();
+
+    if (arg_count != callable->arity) {
+        runtime_error(fmt::format("Expected {0} arguments but got {1}.", callable->arity, arg_count));
+    }
+
+    if (callable->callable_type == ScriptCallableType::Closure) {
+        call(static_cast<ScriptClosure*>(callable), arg_count);
+        return;
+    }
+
+    // builtins and classes are called directly, their result replaces the callee and the arguments on the stack
+    std::vector<ScriptObject> arguments(_stack_top - arg_count, _stack_top);
+    ScriptObject result = callable->call(nullptr, arguments);
+
+    _stack_top = &callee;
+    push(result);
+}
+
+void VM::call(ScriptClosure* closure, u8 arg_count) {
+    // register instructions write their results without pushing, every register of the frame has to fit
+    ScriptObject* slots = _stack_top - arg_count - 1;
+    if (_frame_count == frames_max || static_cast<usize>(_stack_end - slots) < frame_registers) {
+        runtime_error("Stack overflow");
+    }
+
+    CallFrame* frame = &_frames[_frame_count++];
+    frame->closure = closure;
+    frame->ip = closure->proto->chunk.code.data();
+    frame->slots = slots;
+}
+
+void VM::runtime_error(const std::string& message) {
+    u32 line = 0;
+    if (_frame_count > 0) {
+        CallFrame& frame = _frames[_frame_count - 1];
+        auto& chunk = frame.closure->proto->chunk;
+        line = chunk.lines[frame.ip - chunk.code.data() - 1];
+    }
+
+    throw RuntimeError(Token(TT_INVALID, line), message);
+}
+
+} // namespace script